@@ -41,7 +41,7 @@ AprxFairQueue::beginService()
             }
         }
 
-        EventList::Get().sourceIsPendingRel(*this, drainTime(_packets[_currQ].back()));
+        EventList::Get().sourceIsPendingRel(*this, serviceTime(_packets[_currQ].back()));
     }
 }
 
@@ -73,6 +73,7 @@ AprxFairQueue::completeService()
     }
 
     applyEcnMark(*pkt);
+    appendInt(*pkt);
     pkt->sendOn();
 
     beginService();
@@ -220,7 +221,7 @@ AprxFairQueue::hashFlow(int index, uint32_t flowid)
 }
 
 void
-AprxFairQueue::printStats()
+AprxFairQueue::printStats(ostream &out)
 {
     unordered_map<uint32_t, uint32_t> counts;
 
@@ -234,11 +235,11 @@ AprxFairQueue::printStats()
         }
     }
 
-    cout << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
+    out << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
     for (auto it = counts.begin(); it != counts.end(); it++) {
-        cout << " " << it->first << "->" << it->second;
+        out << " " << it->first << "->" << it->second;
     }
-    cout << endl;
+    out << '\n';
 
     //cout << "AFQ: " << _error << " " << _count << " " << _zero << endl;
 }
@@ -26,7 +26,8 @@ public:
     AprxFairQueue(linkspeed_bps bitrate, mem_b maxsize,
                     QueueLogger *logger, struct AFQcfg config = AFQcfg());
     void receivePacket(Packet &pkt);
-    void printStats();
+    bool fastForwardable() const { return false; }
+    void printStats(std::ostream &out);
 
 protected:
     void beginService();
@@ -0,0 +1,188 @@
+/*
+ * Benchmark harness header
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "htsim.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Shared plumbing for the benchmark executables: argument parsing, a
+ * monotonic wall clock and a minimal JSON report. Every benchmark appends
+ * one BenchResult; the report is written in one go at the end so that it
+ * can be diffed between commits.
+ */
+
+typedef std::unordered_map<std::string,std::string> BenchArgs;
+
+inline void
+parseBenchArgs(int argc,
+               char *argv[],
+               BenchArgs &args)
+{
+    for (int i = 1; i < argc; i++) {
+        char *tok = strchr(argv[i], '=');
+        if (argv[i][0] != '-' || argv[i][1] != '-' || tok == NULL) {
+            std::cerr << "Ignoring argument (" << i << ") : " << argv[i] << std::endl;
+            continue;
+        }
+        args[std::string(argv[i] + 2, tok - argv[i] - 2)] = std::string(tok + 1);
+    }
+}
+
+// Returns the monotonic wall clock in seconds.
+inline double
+benchNow()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+inline double
+median(std::vector<double> v)
+{
+    if (v.empty()) {
+        return 0.0;
+    }
+    std::sort(v.begin(), v.end());
+    size_t n = v.size();
+    return (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+inline std::string
+jsonString(const std::string &s)
+{
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+inline std::string
+jsonNumber(double v)
+{
+    if (!std::isfinite(v)) {
+        return "null";
+    }
+    std::ostringstream ss;
+    ss << std::setprecision(10) << v;
+    return ss.str();
+}
+
+struct BenchResult
+{
+    BenchResult(const std::string &n) : name(n) {}
+
+    BenchResult& param(const std::string &key, const std::string &val)
+    {
+        params.push_back(make_pair(key, jsonString(val)));
+        return *this;
+    }
+
+    BenchResult& param(const std::string &key, uint64_t val)
+    {
+        params.push_back(make_pair(key, std::to_string(val)));
+        return *this;
+    }
+
+    BenchResult& metric(const std::string &key, double val)
+    {
+        metrics.push_back(make_pair(key, jsonNumber(val)));
+        return *this;
+    }
+
+    BenchResult& metric(const std::string &key, const std::string &val)
+    {
+        metrics.push_back(make_pair(key, jsonString(val)));
+        return *this;
+    }
+
+    std::string name;
+    std::vector<std::pair<std::string,std::string> > params;
+    std::vector<std::pair<std::string,std::string> > metrics;
+};
+
+class BenchReport
+{
+    public:
+        BenchReport(const std::string &suite) : _suite(suite) {}
+
+        void context(const std::string &key, const std::string &val)
+        {
+            _context.push_back(make_pair(key, jsonString(val)));
+        }
+
+        void context(const std::string &key, double val)
+        {
+            _context.push_back(make_pair(key, jsonNumber(val)));
+        }
+
+        void add(const BenchResult &r) { _results.push_back(r); }
+
+        void write(std::ostream &out)
+        {
+            out << "{\n  \"suite\": " << jsonString(_suite);
+            for (auto &kv : _context) {
+                out << ",\n  " << jsonString(kv.first) << ": " << kv.second;
+            }
+            out << ",\n  \"benchmarks\": [";
+            for (size_t i = 0; i < _results.size(); i++) {
+                const BenchResult &r = _results[i];
+                out << (i ? ",\n" : "\n") << "    {\"name\": " << jsonString(r.name);
+                out << ", \"params\": {";
+                for (size_t j = 0; j < r.params.size(); j++) {
+                    out << (j ? ", " : "") << jsonString(r.params[j].first)
+                        << ": " << r.params[j].second;
+                }
+                out << "}";
+                for (auto &kv : r.metrics) {
+                    out << ", " << jsonString(kv.first) << ": " << kv.second;
+                }
+                out << "}";
+            }
+            out << "\n  ]\n}\n";
+        }
+
+        // Write to the given file, or stdout if the name is empty or "-".
+        void write(const std::string &filename)
+        {
+            if (filename.empty() || filename == "-") {
+                write(std::cout);
+                std::cout.flush();
+                return;
+            }
+
+            std::ofstream out(filename);
+            if (!out) {
+                std::cerr << "Failed to open " << filename << std::endl;
+                exit(1);
+            }
+            write(out);
+        }
+
+    private:
+        std::string _suite;
+        std::vector<std::pair<std::string,std::string> > _context;
+        std::vector<BenchResult> _results;
+};
+
+#endif /* BENCH_H */
@@ -0,0 +1,218 @@
+/*
+ * Fluid model validation against the packet simulator
+ */
+#include "bench.h"
+
+#include "eventlist.h"
+#include "fct-stats.h"
+#include "fluid.h"
+#include "logfile.h"
+#include "output.h"
+#include "rng.h"
+#include "test.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Usage: ./fluidcheck [--filter=<substr>] [--seed=N] [--tolerance=X]
+ *                     [--quantum=<us>] [--out=<file.json>] [--logfile=<path>]
+ *
+ * Runs small cases twice, once packet by packet and once in the fluid model
+ * (--fluid=1), from the same seed, and compares the FCTs of every flow-size
+ * bucket: flows finished, mean and p99. The fluid model has no queues or
+ * congestion control, so it is expected to track the mean FCT, not the
+ * tail; nor the short flows of heavy-tailed mixes (--flowdist=pareto,
+ * datamining), whose packet FCTs are mostly queueing and timeouts behind
+ * the large ones, so the cases here use the uniform workload. Exits
+ * non-zero if some bucket's mean differs by more than the tolerance
+ * (relative, default 0.25). Every run is a forked child, as in macrobench.
+ */
+
+struct Case
+{
+    const char *name;
+    uint32_t expt;
+    ArgList args;
+};
+
+static const vector<Case> cases = {
+    {"single_link_50", 1, {{"duration", "1"}, {"utilization", "0.5"}}},
+    {"single_link_75", 1, {{"duration", "1"}, {"utilization", "0.75"}}},
+    {"conga_ecmp_30", 2, {{"flowgen", "ecmp"}, {"load", "30"}, {"duration", "2"}}},
+    {"conga_ecmp_60", 2, {{"flowgen", "ecmp"}, {"load", "60"}, {"duration", "1"}}},
+    {"conga_ecmp_90", 2, {{"flowgen", "ecmp"}, {"load", "90"}, {"duration", "1"}}},
+};
+
+#define MAX_BUCKETS 8
+
+// What a child reports back to the parent through a pipe.
+struct CaseResult
+{
+    double runSec;
+    uint32_t nBuckets;
+    struct {
+        char label[24];
+        uint64_t flows;
+        double mean;
+        double p99;
+    } buckets[MAX_BUCKETS];
+};
+
+// Runs one case to completion; called in the child process.
+static CaseResult
+runCase(const Case &c,
+        bool fluid,
+        uint32_t seed,
+        const string &logpath)
+{
+    CaseResult res;
+
+    Output::Get().setLevel(Output::LEVEL_QUIET);
+    Rng::_seed = seed;
+    FluidNetwork::_enabled = fluid;
+
+    EventList &eventlist = EventList::Get();
+    Logfile logfile(logpath);
+
+    double start = benchNow();
+    run_experiment(c.expt, c.args, logfile);
+    while (eventlist.doNextEvent()) {}
+    res.runSec = benchNow() - start;
+
+    FctStats &stats = FctStats::Get();
+    res.nBuckets = min(stats.nBuckets(), (uint32_t)MAX_BUCKETS);
+    for (uint32_t b = 0; b < res.nBuckets; b++) {
+        const LogHistogram &fct = stats.fctHistogram(b);
+        snprintf(res.buckets[b].label, sizeof(res.buckets[b].label), "%s",
+                 stats.bucketLabel(b).c_str());
+        res.buckets[b].flows = fct.count();
+        res.buckets[b].mean = fct.mean();
+        res.buckets[b].p99 = fct.percentile(0.99);
+    }
+    return res;
+}
+
+// Forks a child for the case; returns false if it did not finish cleanly.
+static bool
+forkCase(const Case &c,
+         bool fluid,
+         uint32_t seed,
+         const string &logpath,
+         CaseResult &res)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        // Keep simulator chatter out of the JSON report.
+        close(fds[0]);
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            _exit(1);
+        }
+
+        CaseResult r = runCase(c, fluid, seed, logpath);
+        ssize_t n = write(fds[1], &r, sizeof(r));
+        _exit(n == sizeof(r) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], &res, sizeof(res));
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    return n == sizeof(res) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double
+relError(double fluid,
+         double packet)
+{
+    return packet > 0 ? (fluid - packet) / packet : 0.0;
+}
+
+int
+main(int argc,
+     char *argv[])
+{
+    BenchArgs args;
+    parseBenchArgs(argc, argv, args);
+
+    string filter = args.count("filter") ? args["filter"] : "";
+    uint32_t seed = args.count("seed") ? stoul(args["seed"]) : 1729;
+    double tolerance = args.count("tolerance") ? stod(args["tolerance"]) : 0.25;
+    string logpath = args.count("logfile") ? args["logfile"] : "/tmp/htsim-fluidcheck";
+    if (args.count("quantum")) {
+        FluidNetwork::_quantum = timeFromUs(stod(args["quantum"]));
+    }
+
+    BenchReport report("fluidcheck");
+    report.context("seed", seed);
+    report.context("tolerance", tolerance);
+    report.context("quantum_us", timeAsUs(FluidNetwork::_quantum));
+
+    bool ok = true;
+    for (const Case &c : cases) {
+        if (!filter.empty() && string(c.name).find(filter) == string::npos) {
+            continue;
+        }
+
+        CaseResult pkt, fl;
+        if (!forkCase(c, false, seed, logpath, pkt) || !forkCase(c, true, seed, logpath, fl)) {
+            cerr << c.name << " failed" << endl;
+            ok = false;
+            continue;
+        }
+
+        for (uint32_t b = 0; b < pkt.nBuckets && b < fl.nBuckets; b++) {
+            if (pkt.buckets[b].flows == 0 || fl.buckets[b].flows == 0) {
+                continue;
+            }
+
+            double meanErr = relError(fl.buckets[b].mean, pkt.buckets[b].mean);
+            double p99Err = relError(fl.buckets[b].p99, pkt.buckets[b].p99);
+            bool pass = fabs(meanErr) <= tolerance;
+            ok = ok && pass;
+
+            BenchResult br(string(c.name) + "/" + pkt.buckets[b].label);
+            br.param("expt", c.expt);
+            for (auto &kv : c.args) {
+                br.param(kv.first, kv.second);
+            }
+            br.metric("packet_flows", (double)pkt.buckets[b].flows)
+              .metric("fluid_flows", (double)fl.buckets[b].flows)
+              .metric("packet_mean_us", pkt.buckets[b].mean)
+              .metric("fluid_mean_us", fl.buckets[b].mean)
+              .metric("mean_rel_err", meanErr)
+              .metric("packet_p99_us", pkt.buckets[b].p99)
+              .metric("fluid_p99_us", fl.buckets[b].p99)
+              .metric("p99_rel_err", p99Err)
+              .metric("pass", pass ? 1.0 : 0.0);
+            report.add(br);
+
+            cerr << c.name << " " << pkt.buckets[b].label << setprecision(4)
+                 << " mean " << pkt.buckets[b].mean << " / " << fl.buckets[b].mean
+                 << " p99 " << pkt.buckets[b].p99 << " / " << fl.buckets[b].p99
+                 << (pass ? "" : " FAIL") << endl;
+        }
+
+        cerr << c.name << " run " << setprecision(4) << pkt.runSec << " s / "
+             << fl.runSec << " s" << endl;
+    }
+
+    report.write(args.count("out") ? args["out"] : "");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,250 @@
+/*
+ * End-to-end macrobenchmark scenarios
+ */
+#include "bench.h"
+
+#include "eventlist.h"
+#include "fct-stats.h"
+#include "logfile.h"
+#include "output.h"
+#include "rng.h"
+#include "test.h"
+
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+/*
+ * Usage: ./macrobench [--filter=<substr>] [--repeat=N] [--seed=N]
+ *                     [--out=<file.json>] [--logfile=<path>]
+ *
+ * Runs a fixed set of canonical experiments under a fixed seed and reports
+ * wall time, events processed, events/sec, peak RSS and a fingerprint of
+ * the results. The simulator keeps its state in singletons and namespace
+ * globals, so every scenario runs in a forked child of its own. A change in
+ * fingerprint means the simulated outcome changed, not just its speed.
+ */
+
+struct Scenario
+{
+    const char *name;
+    uint32_t expt;
+    ArgList args;
+    double simtimeMs; // Stop the run early at this simulated time (0: no cap).
+};
+
+static const vector<Scenario> scenarios = {
+    {"single_link", 1, {{"duration", "1"}}, 0},
+    {"conga_30", 2, {{"flowgen", "conga"}, {"load", "30"}, {"duration", "2"}}, 0},
+    {"conga_60", 2, {{"flowgen", "conga"}, {"load", "60"}, {"duration", "2"}}, 0},
+    {"conga_90", 2, {{"flowgen", "conga"}, {"load", "90"}, {"duration", "2"}}, 0},
+    // Durations are whole seconds on the fat tree; cap the run instead.
+    {"fat_tree_dctcp", 3, {{"endhost", "dctcp"}, {"utilization", "0.5"}, {"duration", "1"}}, 5},
+};
+
+// What a child reports back to the parent through a pipe.
+struct ScenarioResult
+{
+    double setupSec;
+    double runSec;
+    uint64_t nEvents;
+    uint64_t nFlows;
+    simtime_picosec simtime;
+    uint64_t fingerprint;
+    uint64_t peakRssKb;
+};
+
+// FNV-1a, chained over the fields that make up a run's outcome.
+static uint64_t
+fnv1a(uint64_t h,
+      const void *data,
+      size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+// Runs one scenario to completion; called in the child process.
+static ScenarioResult
+runScenario(const Scenario &sc,
+            uint32_t seed,
+            const string &logpath)
+{
+    ScenarioResult res;
+
+    Output::Get().setLevel(Output::LEVEL_QUIET);
+    Rng::_seed = seed;
+
+    EventList &eventlist = EventList::Get();
+    Logfile logfile(logpath);
+
+    double start = benchNow();
+    run_experiment(sc.expt, sc.args, logfile);
+    res.setupSec = benchNow() - start;
+
+    // Events already pending past the cap are skipped by the check below;
+    // the end time keeps new ones from being queued at all.
+    simtime_picosec cap = 0;
+    if (sc.simtimeMs > 0) {
+        cap = timeFromMs(sc.simtimeMs);
+        eventlist.setEndtime(cap);
+    }
+
+    start = benchNow();
+    while (eventlist.doNextEvent()) {
+        if (cap && eventlist.now() >= cap) {
+            break;
+        }
+    }
+    res.runSec = benchNow() - start;
+
+    res.nEvents = eventlist._nEventsProcessed;
+    res.nFlows = FctStats::Get()._nFlows;
+    res.simtime = eventlist.now();
+
+    ostringstream summary;
+    FctStats::Get().printSummary(summary);
+    string text = summary.str();
+
+    uint64_t h = 14695981039346656037ULL;
+    h = fnv1a(h, &res.nEvents, sizeof(res.nEvents));
+    h = fnv1a(h, &res.nFlows, sizeof(res.nFlows));
+    h = fnv1a(h, &res.simtime, sizeof(res.simtime));
+    h = fnv1a(h, text.data(), text.size());
+    res.fingerprint = h;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    res.peakRssKb = usage.ru_maxrss;
+
+    return res;
+}
+
+// Forks a child for the scenario; returns false if it did not finish cleanly.
+static bool
+forkScenario(const Scenario &sc,
+             uint32_t seed,
+             const string &logpath,
+             ScenarioResult &res)
+{
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+
+    cout.flush();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        exit(1);
+    }
+
+    if (pid == 0) {
+        // Keep simulator chatter out of the JSON report.
+        close(fds[0]);
+        if (freopen("/dev/null", "w", stdout) == NULL) {
+            _exit(1);
+        }
+
+        ScenarioResult r = runScenario(sc, seed, logpath);
+        ssize_t n = write(fds[1], &r, sizeof(r));
+        _exit(n == sizeof(r) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    ssize_t n = read(fds[0], &res, sizeof(res));
+    close(fds[0]);
+
+    int status;
+    waitpid(pid, &status, 0);
+    return n == sizeof(res) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int
+main(int argc,
+     char *argv[])
+{
+    BenchArgs args;
+    parseBenchArgs(argc, argv, args);
+
+    string filter = args.count("filter") ? args["filter"] : "";
+    uint32_t repeat = args.count("repeat") ? stoul(args["repeat"]) : 1;
+    uint32_t seed = args.count("seed") ? stoul(args["seed"]) : 1729;
+    string logpath = args.count("logfile") ? args["logfile"] : "/tmp/htsim-macrobench";
+    if (repeat == 0) {
+        repeat = 1;
+    }
+
+    BenchReport report("macrobench");
+    report.context("seed", seed);
+    report.context("repeat", repeat);
+
+    bool ok = true;
+    for (const Scenario &sc : scenarios) {
+        if (!filter.empty() && string(sc.name).find(filter) == string::npos) {
+            continue;
+        }
+
+        vector<double> wall, run;
+        ScenarioResult res;
+        bool stable = true;
+        uint64_t fingerprint = 0;
+        uint64_t peakRss = 0;
+
+        for (uint32_t r = 0; r < repeat; r++) {
+            if (!forkScenario(sc, seed, logpath, res)) {
+                cerr << sc.name << " failed" << endl;
+                ok = false;
+                break;
+            }
+            if (r > 0 && res.fingerprint != fingerprint) {
+                stable = false;
+            }
+            fingerprint = res.fingerprint;
+            peakRss = max(peakRss, res.peakRssKb);
+            wall.push_back(res.setupSec + res.runSec);
+            run.push_back(res.runSec);
+        }
+        if (run.size() != repeat) {
+            continue;
+        }
+
+        char fp[17];
+        snprintf(fp, sizeof(fp), "%016llx", (unsigned long long)fingerprint);
+
+        double runSec = median(run);
+        BenchResult br(sc.name);
+        br.param("expt", sc.expt);
+        for (auto &kv : sc.args) {
+            br.param(kv.first, kv.second);
+        }
+        if (sc.simtimeMs > 0) {
+            br.param("simtime_cap_ms", (uint64_t)sc.simtimeMs);
+        }
+        br.metric("wall_sec", median(wall))
+          .metric("run_sec", runSec)
+          .metric("events", (double)res.nEvents)
+          .metric("events_per_sec", runSec > 0 ? res.nEvents / runSec : 0.0)
+          .metric("peak_rss_kb", (double)peakRss)
+          .metric("flows_finished", (double)res.nFlows)
+          .metric("simtime_sec", timeAsSec(res.simtime))
+          .metric("fingerprint", string(fp));
+        if (repeat > 1) {
+            br.metric("fingerprint_stable", stable ? 1.0 : 0.0);
+        }
+        report.add(br);
+
+        cerr << sc.name << " " << setprecision(4) << runSec << " s "
+             << res.nEvents / runSec / 1000 << " Kops/s " << fp << endl;
+    }
+
+    report.write(args.count("out") ? args["out"] : "");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,463 @@
+/*
+ * Microbenchmarks for the simulator core primitives
+ */
+#include "bench.h"
+
+#include "aprx-fairqueue.h"
+#include "datapacket.h"
+#include "eventlist.h"
+#include "fairqueue.h"
+#include "logfile.h"
+#include "priorityqueue.h"
+#include "queue.h"
+#include "stoc-fairqueue.h"
+#include "workloads.h"
+
+using namespace std;
+
+/*
+ * Usage: ./microbench [--filter=<substr>] [--repeat=N] [--scale=X]
+ *                     [--seed=N] [--out=<file.json>] [--logfile=<path>]
+ *
+ * Each benchmark is run --repeat times; the JSON report carries the
+ * median and best ns/op over the repetitions. --scale multiplies the
+ * number of operations per repetition.
+ */
+
+struct BenchOptions
+{
+    string filter;
+    uint32_t repeat;
+    double scale;
+    uint32_t seed;
+    string logpath;
+
+    bool selected(const string &name) const
+    {
+        return filter.empty() || name.find(filter) != string::npos;
+    }
+
+    uint64_t ops(uint64_t base) const
+    {
+        return max((uint64_t)1, (uint64_t)(base * scale));
+    }
+};
+
+// Small xorshift generator, so input generation stays off the profile.
+class BenchRng
+{
+    public:
+        BenchRng(uint64_t seed) : _s(seed ? seed : 88172645463325252ULL) {}
+
+        inline uint64_t next()
+        {
+            _s ^= _s << 13;
+            _s ^= _s >> 7;
+            _s ^= _s << 17;
+            return _s;
+        }
+
+        inline double uniform() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+    private:
+        uint64_t _s;
+};
+
+// Times fn() over opt.repeat repetitions of nOps operations each.
+template<class F>
+static BenchResult
+runBench(const string &name,
+         const BenchOptions &opt,
+         uint64_t nOps,
+         F fn)
+{
+    vector<double> nsPerOp;
+
+    for (uint32_t r = 0; r < opt.repeat; r++) {
+        double start = benchNow();
+        uint64_t done = fn();
+        double elapsed = benchNow() - start;
+        nsPerOp.push_back(elapsed * 1e9 / (done ? done : nOps));
+    }
+
+    double med = median(nsPerOp);
+    BenchResult res(name);
+    res.metric("ops", (double)nOps)
+       .metric("ns_per_op", med)
+       .metric("ns_per_op_min", *min_element(nsPerOp.begin(), nsPerOp.end()))
+       .metric("mops_per_sec", med > 0 ? 1000.0 / med : 0.0);
+    return res;
+}
+
+// Adds a result to the report and echoes it on stderr.
+static void
+record(BenchReport &report,
+       const BenchResult &res)
+{
+    cerr << res.name;
+    for (auto &kv : res.params) {
+        cerr << " " << kv.first << "=" << kv.second;
+    }
+    for (auto &kv : res.metrics) {
+        if (kv.first == "ns_per_op") {
+            cerr << " " << kv.second << " ns/op";
+        }
+    }
+    cerr << endl;
+    report.add(res);
+}
+
+/*
+ * EventList: hold model. A fixed population of sources stays pending; each
+ * event reschedules its source at now + delay, so every op is one pop and
+ * one insert at the steady-state heap size.
+ */
+
+enum DelayDist { DELAY_CONSTANT, DELAY_EXPONENTIAL, DELAY_MIXED };
+
+class HoldSource : public EventSource
+{
+    public:
+        HoldSource(const vector<simtime_picosec> &delays, uint64_t &budget)
+            : EventSource("hold"), _delays(delays), _budget(budget), _next(0) {}
+
+        void doNextEvent()
+        {
+            if (_budget == 0) {
+                return;
+            }
+            _budget--;
+            EventList::Get().sourceIsPendingRel(*this, _delays[_next++ & (_delays.size() - 1)]);
+        }
+
+    private:
+        const vector<simtime_picosec> &_delays;
+        uint64_t &_budget;
+        uint32_t _next;
+};
+
+static vector<simtime_picosec>
+makeDelays(DelayDist dist,
+           BenchRng &rng)
+{
+    vector<simtime_picosec> delays(1 << 16);
+
+    for (auto &d : delays) {
+        switch (dist) {
+            case DELAY_CONSTANT:
+                // MSS serialization at 10Gbps; lots of ties.
+                d = timeFromNs(1200);
+                break;
+
+            case DELAY_EXPONENTIAL:
+                d = timeFromUs(-log(1.0 - rng.uniform()) * 10);
+                break;
+
+            case DELAY_MIXED:
+                // Mostly serialization/propagation, some RTO-scale timers.
+                if (rng.uniform() < 0.9) {
+                    d = timeFromNs(100 + rng.uniform() * 2000);
+                } else {
+                    d = timeFromUs(MIN_RTO_US + rng.uniform() * (INIT_RTO_US - MIN_RTO_US));
+                }
+                break;
+        }
+    }
+    return delays;
+}
+
+static void
+benchEventList(BenchReport &report,
+               const BenchOptions &opt)
+{
+    const char *distNames[] = {"constant", "exponential", "mixed"};
+    const uint32_t pending[] = {64, 4096, 262144};
+
+    for (uint32_t dist = DELAY_CONSTANT; dist <= DELAY_MIXED; dist++) {
+        for (uint32_t n : pending) {
+            string name = "eventlist/hold";
+            if (!opt.selected(name)) {
+                return;
+            }
+
+            BenchRng rng(opt.seed);
+            vector<simtime_picosec> delays = makeDelays((DelayDist)dist, rng);
+            uint64_t nOps = opt.ops(2000000);
+            uint64_t budget = 0;
+
+            vector<HoldSource*> sources;
+            for (uint32_t i = 0; i < n; i++) {
+                sources.push_back(new HoldSource(delays, budget));
+            }
+
+            BenchResult res = runBench(name, opt, nOps, [&]() {
+                EventList &ev = EventList::Get();
+                budget = nOps;
+                uint64_t before = ev._nEventsProcessed;
+
+                for (uint32_t i = 0; i < n; i++) {
+                    ev.sourceIsPendingRel(*sources[i], delays[i & (delays.size() - 1)]);
+                }
+                while (ev.doNextEvent()) {}
+
+                return ev._nEventsProcessed - before;
+            });
+            record(report, res.param("delay", distNames[dist]).param("pending", n));
+
+            for (auto s : sources) {
+                delete s;
+            }
+        }
+    }
+}
+
+/*
+ * PacketDB: DataPacket::newpkt()/free() with a given number of packets
+ * outstanding between allocation and release.
+ */
+static void
+benchPacketDB(BenchReport &report,
+              const BenchOptions &opt)
+{
+    const uint32_t outstanding[] = {1, 64, 4096};
+
+    for (uint32_t n : outstanding) {
+        string name = "packetdb/newpkt_free";
+        if (!opt.selected(name)) {
+            return;
+        }
+
+        PacketFlow flow(NULL);
+        route_t route;
+        vector<DataPacket*> pkts(n);
+        uint64_t nOps = opt.ops(10000000);
+
+        BenchResult res = runBench(name, opt, nOps, [&]() {
+            uint64_t done = 0;
+            while (done < nOps) {
+                for (uint32_t i = 0; i < n; i++) {
+                    pkts[i] = DataPacket::newpkt(flow, route, done + i, MSS_BYTES);
+                }
+                for (uint32_t i = 0; i < n; i++) {
+                    pkts[i]->free();
+                }
+                done += n;
+            }
+            return done;
+        });
+        record(report, res.param("outstanding", n));
+    }
+}
+
+/*
+ * Queues: bursts of MSS packets spread over a number of flows are pushed
+ * into the queue and drained through the eventlist into a sink, so each op
+ * is one enqueue, one service event and one dequeue.
+ */
+
+class BenchSink : public PacketSink
+{
+    public:
+        BenchSink() : _received(0) {}
+
+        void receivePacket(Packet &pkt)
+        {
+            _received++;
+            pkt.free();
+        }
+
+        uint64_t _received;
+};
+
+#define QUEUE_BURST 1024
+
+static Queue *
+makeQueue(const string &type)
+{
+    linkspeed_bps rate = speedFromGbps(10);
+    mem_b size = 2 * QUEUE_BURST * MSS_BYTES;
+
+    if (type == "fifo") {
+        return new Queue(rate, size, NULL);
+    } else if (type == "fq") {
+        return new FairQueue(rate, size, NULL);
+    } else if (type == "afq") {
+        return new AprxFairQueue(rate, size, NULL);
+    } else if (type == "sfq") {
+        return new StocFairQueue(rate, size, NULL);
+    } else {
+        return new PriorityQueue(rate, size, NULL);
+    }
+}
+
+static void
+benchQueues(BenchReport &report,
+            const BenchOptions &opt)
+{
+    const char *types[] = {"fifo", "fq", "afq", "sfq", "pq"};
+    const uint32_t nFlows[] = {1, 16, 256, 4096};
+
+    for (const char *type : types) {
+        for (uint32_t n : nFlows) {
+            string name = string("queue/") + type;
+            if (!opt.selected(name)) {
+                break;
+            }
+
+            Queue *queue = makeQueue(type);
+            BenchSink sink;
+            route_t route;
+            route.push_back(queue);
+            route.push_back(&sink);
+
+            vector<PacketFlow*> flows;
+            for (uint32_t i = 0; i < n; i++) {
+                flows.push_back(new PacketFlow(NULL));
+            }
+
+            BenchRng rng(opt.seed);
+            uint64_t nOps = opt.ops(type == string("fq") ? 200000 : 2000000);
+            uint64_t seqno = 0;
+            uint64_t sent = 0;
+
+            BenchResult res = runBench(name, opt, nOps, [&]() {
+                uint64_t offered = 0;
+                while (offered < nOps) {
+                    for (uint32_t i = 0; i < QUEUE_BURST; i++) {
+                        PacketFlow *flow = flows[rng.next() % n];
+                        DataPacket *pkt = DataPacket::newpkt(*flow, route, seqno++, MSS_BYTES);
+                        pkt->setPriority(rng.next() % 8);
+                        pkt->sendOn();
+                    }
+                    while (EventList::Get().doNextEvent()) {}
+                    offered += QUEUE_BURST;
+                }
+                sent += offered;
+                return offered;
+            });
+            record(report, res.param("flows", n)
+                       .metric("delivered_fraction", (double)sink._received / sent));
+
+            delete queue;
+            for (auto f : flows) {
+                delete f;
+            }
+        }
+    }
+}
+
+#define WORKLOAD_BATCH 256
+
+/*
+ * Workloads::generateFlowSize for every built-in distribution, and
+ * generateFlowSizes in batches for the CDF-based ones.
+ */
+static void
+benchWorkloads(BenchReport &report,
+               const BenchOptions &opt)
+{
+    const char *distNames[] = {"uniform", "pareto", "enterprise", "datamining"};
+
+    for (uint32_t dist = Workloads::UNIFORM; dist <= Workloads::DATAMINING; dist++) {
+        string name = "workloads/generateFlowSize";
+        if (!opt.selected(name)) {
+            continue;
+        }
+
+        Workloads workload(100000, (Workloads::FlowDist)dist);
+        uint64_t nOps = opt.ops(5000000);
+        uint64_t total = 0;
+
+        BenchResult res = runBench(name, opt, nOps, [&]() {
+            for (uint64_t i = 0; i < nOps; i++) {
+                total += workload.generateFlowSize();
+            }
+            return nOps;
+        });
+        record(report, res.param("dist", distNames[dist])
+                   .metric("mean_size", (double)total / (nOps * opt.repeat)));
+    }
+
+    for (uint32_t dist = Workloads::ENTERPRISE; dist <= Workloads::DATAMINING; dist++) {
+        string name = "workloads/generateFlowSizes";
+        if (!opt.selected(name)) {
+            continue;
+        }
+
+        Workloads workload(100000, (Workloads::FlowDist)dist);
+        uint64_t nOps = max(opt.ops(5000000) / WORKLOAD_BATCH, (uint64_t)1) * WORKLOAD_BATCH;
+        uint64_t total = 0;
+        vector<uint64_t> sizes(WORKLOAD_BATCH);
+
+        BenchResult res = runBench(name, opt, nOps, [&]() {
+            for (uint64_t i = 0; i < nOps; i += WORKLOAD_BATCH) {
+                workload.generateFlowSizes(sizes.data(), WORKLOAD_BATCH);
+                for (uint64_t size : sizes) {
+                    total += size;
+                }
+            }
+            return nOps;
+        });
+        record(report, res.param("dist", distNames[dist])
+                   .param("batch", WORKLOAD_BATCH)
+                   .metric("mean_size", (double)total / (nOps * opt.repeat)));
+    }
+}
+
+/*
+ * Logfile::writeRecord, including the periodic flush of full buffers.
+ */
+static void
+benchLogfile(BenchReport &report,
+             const BenchOptions &opt)
+{
+    string name = "logfile/writeRecord";
+    if (!opt.selected(name)) {
+        return;
+    }
+
+    uint64_t nOps = opt.ops(2000000);
+
+    BenchResult res = runBench(name, opt, nOps, [&]() {
+        Logfile logfile(opt.logpath);
+        for (uint64_t i = 0; i < nOps; i++) {
+            logfile.writeRecord(QueueLogger::QUEUE_RECORD, i & 0xffff,
+                                QueueLogger::CUM_TRAFFIC, i, i * 0.5, i * 0.25);
+        }
+        return nOps;
+    });
+    record(report, res.param("buffer_records", MAX_RECORDS));
+}
+
+int
+main(int argc,
+     char *argv[])
+{
+    BenchArgs args;
+    parseBenchArgs(argc, argv, args);
+
+    BenchOptions opt;
+    opt.filter = args.count("filter") ? args["filter"] : "";
+    opt.repeat = args.count("repeat") ? stoul(args["repeat"]) : 5;
+    opt.scale = args.count("scale") ? stod(args["scale"]) : 1.0;
+    opt.seed = args.count("seed") ? stoul(args["seed"]) : 1729;
+    Rng::_seed = opt.seed;
+    opt.logpath = args.count("logfile") ? args["logfile"] : "/tmp/htsim-microbench";
+    if (opt.repeat == 0) {
+        opt.repeat = 1;
+    }
+
+    BenchReport report("microbench");
+    report.context("seed", opt.seed);
+    report.context("repeat", opt.repeat);
+    report.context("scale", opt.scale);
+
+    benchEventList(report, opt);
+    benchPacketDB(report, opt);
+    benchQueues(report, opt);
+    benchWorkloads(report, opt);
+    benchLogfile(report, opt);
+
+    report.write(args.count("out") ? args["out"] : "");
+    return 0;
+}
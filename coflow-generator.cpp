@@ -0,0 +1,76 @@
+/*
+ * Coflow generator
+ */
+#include "coflow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+using namespace std;
+
+CoflowGenerator::CoflowGenerator(DataSource::EndHost endhost,
+                                 route_gen_t rg,
+                                 linkspeed_bps flowRate,
+                                 uint32_t nHosts,
+                                 uint32_t mappers,
+                                 uint32_t reducers,
+                                 uint32_t avgFlowSize,
+                                 Workloads::FlowDist flowSizeDist)
+    : FlowGenerator(endhost, rg, flowRate, avgFlowSize, flowSizeDist),
+    _mappers(mappers),
+    _reducers(reducers),
+    _hosts(nHosts)
+{
+    if (mappers == 0 || reducers == 0 || mappers + reducers > nHosts) {
+        fprintf(stderr, "Coflow of %u mappers and %u reducers needs 1 to %u hosts\n",
+                mappers, reducers, nHosts);
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < nHosts; i++) {
+        _hosts[i] = i;
+    }
+
+    // The rate is in flows; a coflow carries mappers x reducers of them,
+    // all starting together.
+    _avgFlowArrivalTime *= (simtime_picosec)mappers * reducers;
+    setStartJitter(0);
+}
+
+void
+CoflowGenerator::doNextEvent()
+{
+    if (EventList::Get().now() == _endTime) {
+        OUTPUT(SUMMARY) << "Coflows " << _nGroups << " completed " << _nGroupsDone
+                        << " mappers " << _mappers << " reducers " << _reducers << '\n';
+        dumpLiveFlows();
+        return;
+    }
+
+    startCoflow();
+    EventList::Get().sourceIsPendingRel(*this, _rng.exponential(1.0/_avgFlowArrivalTime));
+}
+
+void
+CoflowGenerator::startCoflow()
+{
+    // The first mappers + reducers hosts of a partial shuffle.
+    uint32_t n = _hosts.size();
+    uint32_t m = _mappers + _reducers;
+    for (uint32_t i = 0; i < m; i++) {
+        swap(_hosts[i], _hosts[i + _rng.below(n - i)]);
+    }
+
+    uint32_t coflow = newGroup();
+    for (uint32_t i = 0; i < _mappers; i++) {
+        for (uint32_t j = _mappers; j < m; j++) {
+            addToGroup(coflow, createFlow(_workload.generateFlowSize(), 0, _hosts[i], _hosts[j]));
+        }
+    }
+}
+
+void
+CoflowGenerator::finishGroup(uint32_t,
+                             simtime_picosec time)
+{
+    FctStats::Get().recordCompletion("CCT", time);
+}
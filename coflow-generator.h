@@ -0,0 +1,39 @@
+/*
+ * Coflow generator header
+ */
+#ifndef COFLOW_GENERATOR_H
+#define COFLOW_GENERATOR_H
+
+#include "flow-generator.h"
+
+#include <vector>
+
+/*
+ * Shuffles between the stages of a job: coflows arrive as a Poisson
+ * process, each with its own random mappers and reducers (no host is
+ * both), and every mapper sends a flow of a size from the workload
+ * distribution to every reducer. A coflow completes with its last flow;
+ * its completion time (CCT) goes to FctStats, next to its flows' FCTs.
+ * flowRate is the offered load of all coflows together.
+ */
+class CoflowGenerator : public FlowGenerator
+{
+    public:
+        CoflowGenerator(DataSource::EndHost endhost, route_gen_t rg, linkspeed_bps flowRate,
+                uint32_t nHosts, uint32_t mappers, uint32_t reducers,
+                uint32_t avgFlowSize, Workloads::FlowDist flowSizeDist);
+        void doNextEvent();
+
+    private:
+        // Starts a coflow: a flow from each mapper to each reducer.
+        void startCoflow();
+        void finishGroup(uint32_t group, simtime_picosec time);
+
+        uint32_t _mappers;
+        uint32_t _reducers;
+
+        // Hosts, shuffled in place to pick mappers and reducers.
+        std::vector<uint32_t> _hosts;
+};
+
+#endif /* COFLOW_GENERATOR_H */
@@ -6,6 +6,8 @@
 
 #include "network.h"
 
+#define MAX_SACK_BLOCKS 3     // As fit in the TCP option space with timestamps.
+
 // DataPacket and DataAck are subclasses of Packet used by TcpSrc and other flow control protocols.
 // They incorporate a packet database, to reuse packet objects that are no longer needed.
 // Note: you never construct a new DataPacket or DataAck directly; 
@@ -25,12 +27,14 @@ public:
         // This will ID the packet by its last byte.
         p->set(flow, route, size, seqno);
         p->_seqno = seqno;
+        p->_dsn = 0;
         flow._nPackets++;
         return p;
     }
 
     void free() {
         flow()._nPackets--;
+        releaseInt();
         _packetdb.freePacket(this);
     }
 
@@ -38,8 +42,13 @@ public:
     inline simtime_picosec ts() const { return _ts; }
     inline void set_ts(simtime_picosec ts) { _ts = ts; }
 
+    // Multipath: connection-level sequence number of the data carried.
+    inline seq_t dsn() const { return _dsn; }
+    inline void set_dsn(seq_t dsn) { _dsn = dsn; }
+
 protected:
     seq_t _seqno;
+    seq_t _dsn;
     simtime_picosec _ts;
 
     static PacketDB<DataPacket> _packetdb;
@@ -57,17 +66,37 @@ public:
         p->set(flow, route, ACK_SIZE, ackno);
         p->_seqno = seqno;
         p->_ackno = ackno;
+        p->_nSack = 0;
+        p->_segments = 1;
+        p->_data_ackno = 0;
         flow._nPackets++;
         return p;
     }
 
     void free() {
         flow()._nPackets--;
+        releaseInt();
         _packetdb.freePacket(this);
     }
 
     inline seq_t seqno() const { return _seqno; }
     inline seq_t ackno() const { return _ackno; }
+
+    // Multipath: connection-level cumulative ack.
+    inline seq_t data_ackno() const { return _data_ackno; }
+    inline void set_data_ackno(seq_t ackno) { _data_ackno = ackno; }
+
+    // SACK blocks: received byte ranges [start, end) above ackno.
+    inline void addSack(seq_t start, seq_t end) {
+        assert(_nSack < MAX_SACK_BLOCKS);
+        _sack[_nSack++] = std::make_pair(start, end);
+    }
+    inline uint32_t nSack() const { return _nSack; }
+    inline const std::pair<seq_t,seq_t> &sack(uint32_t i) const { return _sack[i]; }
+
+    // Number of data segments this ack covers (more than one if delayed).
+    inline uint32_t segments() const { return _segments; }
+    inline void setSegments(uint32_t n) { _segments = n; }
     inline simtime_picosec ts() const { return _ts; }
     inline void set_ts(simtime_picosec ts) { _ts = ts; }
 
@@ -100,8 +129,13 @@ public:
 protected:
     seq_t _seqno;
     seq_t _ackno;
+    seq_t _data_ackno;
     simtime_picosec _ts;
 
+    uint32_t _nSack;
+    std::pair<seq_t,seq_t> _sack[MAX_SACK_BLOCKS];
+    uint32_t _segments;
+
     static PacketDB<DataAck> _packetdb;
 };
 
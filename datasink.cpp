@@ -17,44 +17,33 @@ DataSink::connect(DataSource &src, route_t &route)
 void 
 DataSink::processDataPacket(DataPacket &pkt)
 {
-    mem_b size = pkt.size();
-    DataPacket::seq_t seqno = pkt.seqno();
+    // A trimmed packet lost its payload on the way.
+    if (pkt.getFlag(Packet::TRIMMED)) {
+        return;
+    }
+
+    addSegment(_cumulative_ack, _received, pkt.seqno(), pkt.size());
+}
 
-    if (seqno == _cumulative_ack + 1) {
+void
+DataSink::addSegment(DataAck::seq_t &cumulativeAck,
+                     ReorderBuffer &received,
+                     DataPacket::seq_t seqno,
+                     mem_b size)
+{
+    if (seqno == cumulativeAck + 1) {
         // It's the next expected sequence number.
-        _cumulative_ack = seqno + size - 1;
+        cumulativeAck = seqno + size - 1;
 
         // Are there any additional received packets that we can now ack?
-        while (!_received.empty()) {
-            pair<DataAck::seq_t,mem_b> packet = _received.front();
-
-            if (_cumulative_ack + 1 == packet.first) {
-                _received.pop_front();
-                _cumulative_ack += packet.second;
-            } else {
-                break;
-            }
+        if (!received.empty()) {
+            cumulativeAck += received.advance(cumulativeAck + 1);
         }
-    } else if (seqno <= _cumulative_ack) {
+    } else if (seqno <= cumulativeAck) {
         // Must have been a bad retransmit, do nothing.
     } else {
         // It's not the next expected sequence number.
-        if (_received.empty()) {
-            _received.push_back(make_pair(seqno, size));
-        } else if (seqno > _received.back().first) {
-            _received.push_back(make_pair(seqno, size));
-        } else {
-            // Insert the packet in the right position.
-            for (auto i = _received.begin(); i != _received.end(); i++) {
-                if (seqno == i->first) {
-                    // Probably a bad retransmit.
-                    break;
-                } else if (seqno < i->first) {
-                    _received.insert(i, make_pair(seqno, size));
-                    break;
-                }
-            }
-        }
+        received.add(seqno, size, cumulativeAck + 1);
     }
 }
 
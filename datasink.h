@@ -6,8 +6,7 @@
 
 #include "loggertypes.h"
 #include "datapacket.h"
-
-#include <list>
+#include "reorder-buffer.h"
 
 class DataSource;
 
@@ -26,11 +25,16 @@ class DataSink : public PacketSink, public Logged
         uint32_t drops();
 
         DataAck::seq_t _cumulative_ack;
-        std::list<std::pair<DataAck::seq_t,mem_b> > _received;
+        ReorderBuffer _received; // Out-of-order data above _cumulative_ack.
 
         uint32_t _node_id;
 
     protected:
+        // Fold the segment [seqno, seqno + size) into a cumulative ack and
+        // the reorder buffer of data held above it.
+        static void addSegment(DataAck::seq_t &cumulativeAck, ReorderBuffer &received,
+                               DataPacket::seq_t seqno, mem_b size);
+
         DataSource *_src;
         route_t *_route;  // Back to source.
 };
@@ -2,6 +2,7 @@
  * DataSource
  */
 #include "datasource.h"
+#include "output.h"
 
 using namespace std;
 
@@ -52,7 +53,7 @@ DataSource::connect(simtime_picosec start_time,
     _flow.id = id; // identify the packet flow with the datasource that generated it
 
     // Ming added _flowsize
-    cout << str() << " " << timeAsUs(_start_time) << " " << id << " " << _flowsize << " " << _node_id << " " << _sink->_node_id << endl;
+    OUTPUT(FLOW_START) << str() << " " << timeAsUs(_start_time) << " " << id << " " << _flowsize << " " << _node_id << " " << _sink->_node_id << '\n';
 
     _sink->connect(*this, *_route_rev);
     EventList::Get().sourceIsPending(*this, _start_time);
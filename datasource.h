@@ -27,7 +27,14 @@ class DataSource : public EventSource, public PacketSink
             D_TCP,    // Deadline TCP
             D_DCTCP,  // Deadline DCTCP
             PKTPAIR,  // Packet pair
-            TIMELY
+            TIMELY,
+            DCQCN,    // RoCE with DCQCN
+            HPCC,     // RoCE with HPCC
+            SWIFT,    // Swift delay-based
+            NDP,      // Receiver-driven, over trimming queues
+            PFABRIC,  // TCP with remaining-size priorities, over priority queues
+            MPTCP,    // Multipath TCP, coupled (LIA) subflows
+            FLUID     // Flow-level, max-min fair rates (no packets)
         };
 
         virtual void printStatus() = 0;
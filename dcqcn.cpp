@@ -0,0 +1,94 @@
+/*
+ * DCQCN
+ */
+#include "dcqcn.h"
+
+using namespace std;
+
+DcqcnSrc::DcqcnSrc(TrafficLogger *pktlogger,
+                   uint64_t flowsize,
+                   simtime_picosec duration)
+    : RdmaSrc(pktlogger, flowsize, duration),
+      _target_rate(_rate),
+      _alpha(1.0),
+      _nCnps(0),
+      _line_rate(_rate),
+      _cnp_in_period(false),
+      _next_alpha_update(0),
+      _next_increase(0),
+      _increase_bytes(0),
+      _timer_stage(0),
+      _byte_stage(0)
+{
+    // Constructor
+}
+
+void
+DcqcnSrc::processCnp(simtime_picosec now)
+{
+    updateRate(now);
+    _nCnps++;
+
+    // Cut the rate, remembering where we were as the target.
+    _target_rate = _rate;
+    _rate = max((linkspeed_bps)llround(_rate * (1 - _alpha / 2)), (linkspeed_bps)DCQCN_MIN_RATE);
+    _alpha = (1 - DCQCN_G) * _alpha + DCQCN_G;
+    _cnp_in_period = true;
+
+    // Restart the increase stages.
+    _timer_stage = 0;
+    _byte_stage = 0;
+    _increase_bytes = _packets_sent;
+    _next_increase = now + DCQCN_RATE_TIMER;
+    _next_alpha_update = now + DCQCN_ALPHA_TIMER;
+}
+
+void
+DcqcnSrc::updateRate(simtime_picosec now)
+{
+    // Nothing to recover from until the first CNP.
+    if (_nCnps == 0) {
+        return;
+    }
+
+    while (now >= _next_alpha_update) {
+        if (!_cnp_in_period) {
+            _alpha = (1 - DCQCN_G) * _alpha;
+        }
+        _cnp_in_period = false;
+        _next_alpha_update += DCQCN_ALPHA_TIMER;
+    }
+
+    while (now >= _next_increase) {
+        _timer_stage++;
+        increaseRate();
+        _next_increase += DCQCN_RATE_TIMER;
+    }
+
+    while (_packets_sent - _increase_bytes >= DCQCN_BYTE_COUNTER) {
+        _byte_stage++;
+        increaseRate();
+        _increase_bytes += DCQCN_BYTE_COUNTER;
+    }
+}
+
+void
+DcqcnSrc::increaseRate()
+{
+    uint32_t hi = max(_timer_stage, _byte_stage);
+    uint32_t lo = min(_timer_stage, _byte_stage);
+
+    if (lo > DCQCN_F) {
+        // Hyper increase.
+        _target_rate += (lo - DCQCN_F) * DCQCN_RHAI;
+    } else if (hi >= DCQCN_F) {
+        // Additive increase.
+        _target_rate += DCQCN_RAI;
+    }
+    // Otherwise fast recovery: converge on the target as it is.
+
+    if (_target_rate > _line_rate) {
+        _target_rate = _line_rate;
+    }
+    _rate = (_rate + _target_rate) / 2;
+}
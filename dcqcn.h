@@ -0,0 +1,52 @@
+/*
+ * DCQCN header
+ */
+#ifndef DCQCN_H
+#define DCQCN_H
+
+#include "rdma.h"
+
+#define DCQCN_G            (1.0 / 256)        // Alpha gain.
+#define DCQCN_ALPHA_TIMER  timeFromUs(55)     // Alpha decays if no CNP for this long.
+#define DCQCN_RATE_TIMER   timeFromUs(55)     // Rate increase timer.
+#define DCQCN_BYTE_COUNTER (10 * 1000 * 1000) // Rate increase byte counter.
+#define DCQCN_F            5                  // Fast recovery stages.
+#define DCQCN_RAI          40000000L          // Additive increase, 40Mbps.
+#define DCQCN_RHAI         400000000L         // Hyper increase, 400Mbps.
+#define DCQCN_MIN_RATE     10000000L          // 10Mbps
+
+/*
+ * DCQCN (Zhu et al., SIGCOMM 2015) reaction point. The sink sends a CNP
+ * when it sees ECN_FWD, at most one per CNP_INTERVAL; each CNP cuts the
+ * rate by alpha/2. Without CNPs the rate climbs back towards the target
+ * in fast recovery, additive and hyper increase stages, driven by a timer
+ * and a byte counter. The timers are run lazily, when the flow next sends
+ * or gets a CNP, so they cost no events.
+ */
+class DcqcnSrc : public RdmaSrc
+{
+    public:
+        DcqcnSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+                 simtime_picosec duration = 0);
+
+        linkspeed_bps _target_rate;
+        double _alpha;
+        uint32_t _nCnps;
+
+    protected:
+        void processCnp(simtime_picosec now);
+        void updateRate(simtime_picosec now);
+
+    private:
+        void increaseRate();
+
+        linkspeed_bps _line_rate;
+        bool _cnp_in_period;     // A CNP arrived this alpha period.
+        simtime_picosec _next_alpha_update;
+        simtime_picosec _next_increase;
+        uint64_t _increase_bytes; // _packets_sent at the last byte counter stage.
+        uint32_t _timer_stage;
+        uint32_t _byte_stage;
+};
+
+#endif /* DCQCN_H */
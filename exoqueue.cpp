@@ -1,6 +1,6 @@
 #include "exoqueue.h"
 
-ExoQueue::ExoQueue(double loss_rate) : _loss_rate(loss_rate) {}
+ExoQueue::ExoQueue(double loss_rate) : _loss_rate(loss_rate), _rng(Rng::nameFor("exoqueue")) {}
 
 void
 ExoQueue::setLossRate(double l)
@@ -11,7 +11,7 @@ ExoQueue::setLossRate(double l)
 void
 ExoQueue::receivePacket(Packet &pkt) 
 {
-    if (drand() < _loss_rate) {
+    if (_rng.uniform() < _loss_rate) {
         pkt.free();
         return;
     }
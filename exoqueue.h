@@ -6,6 +6,7 @@
  */
 
 #include "network.h"
+#include "rng.h"
 
 class ExoQueue : public PacketSink
 {
@@ -16,6 +17,7 @@ public:
 
     // Housekeeping
     double _loss_rate;
+    Rng _rng;
 };
 
 #endif
@@ -6,7 +6,8 @@ using namespace std;
 
 FairQueue::FairQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger)
     : Queue(bitrate, maxsize, logger), _roundUpdate(0),
-      _nActiveFlows(0), _roundNumber(0), _exactRoundNumber(0.0)
+      _nActiveFlows(0), _roundNumber(0), _exactRoundNumber(0.0),
+      _currentPkt(NULL)
 {
     _mode = LAZY;
 }
@@ -25,7 +26,7 @@ FairQueue::beginService()
         _packets.erase(_packets.begin());
 
         // Schedule it's completion time.
-        EventList::Get().sourceIsPendingRel(*this, drainTime(_currentPkt));
+        EventList::Get().sourceIsPendingRel(*this, serviceTime(_currentPkt));
 
         if (TRACE_PKT == _currentPkt->flow().id) {
             cout << str() << " Pkt depart sched " << EventList::Get().now() << " " << _roundNumber << " "
@@ -61,6 +62,7 @@ FairQueue::completeService()
 
     // Fair-queue shouldn't need ECN marks as it drops the most "unfair" packet.
     applyEcnMark(*_currentPkt);
+    appendInt(*_currentPkt);
     _currentPkt->sendOn();
 
     // Clear packet being transmitted.
@@ -198,7 +200,7 @@ FairQueue::updateRoundNumber()
 }
 
 void
-FairQueue::printStats()
+FairQueue::printStats(ostream &out)
 {
     unordered_map<uint32_t, uint32_t> counts;
 
@@ -210,9 +212,9 @@ FairQueue::printStats()
         counts[fid] = counts[fid] + 1;
     }
 
-    cout << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
+    out << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
     for (auto it = counts.begin(); it != counts.end(); it++) {
-        cout << " " << it->first << "->" << it->second;
+        out << " " << it->first << "->" << it->second;
     }
-    cout << endl;
+    out << '\n';
 }
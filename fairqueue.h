@@ -34,7 +34,8 @@ class FairQueue : public Queue
 public:
     FairQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger);
     void receivePacket(Packet &pkt);
-    void printStats();
+    bool fastForwardable() const { return false; }
+    void printStats(std::ostream &out);
 
 protected:
     void beginService();
@@ -0,0 +1,272 @@
+/*
+ * Flow completion time statistics
+ */
+#include "fct-stats.h"
+#include "datasink.h"
+#include "datasource.h"
+#include "pipe.h"
+#include "queue.h"
+
+using namespace std;
+
+#define RECORD_FILE_BUFFER (1 << 20)
+
+LogHistogram::LogHistogram(double minValue,
+                           uint32_t octaves,
+                           uint32_t subBuckets)
+    : _minValue(minValue),
+    _subBuckets(subBuckets),
+    _buckets(octaves * subBuckets + 1, 0),
+    _count(0),
+    _sum(0),
+    _max(0)
+{}
+
+void
+LogHistogram::add(double value)
+{
+    uint32_t i = 0;
+    if (value > _minValue) {
+        i = (uint32_t)(log2(value / _minValue) * _subBuckets) + 1;
+        if (i >= _buckets.size()) {
+            i = _buckets.size() - 1;
+        }
+    }
+
+    _buckets[i]++;
+    _count++;
+    _sum += value;
+    if (value > _max) {
+        _max = value;
+    }
+}
+
+void
+LogHistogram::clear()
+{
+    fill(_buckets.begin(), _buckets.end(), 0);
+    _count = 0;
+    _sum = 0;
+    _max = 0;
+}
+
+double
+LogHistogram::percentile(double p) const
+{
+    if (_count == 0) {
+        return 0.0;
+    }
+
+    uint64_t rank = (uint64_t)ceil(p * _count);
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < _buckets.size(); i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            if (i == 0) {
+                return min(_minValue, _max);
+            }
+            // Upper edge of the bucket, never above the largest sample.
+            double upper = _minValue * exp2((double)i / _subBuckets);
+            return min(upper, _max);
+        }
+    }
+    return _max;
+}
+
+
+FctStats *FctStats::instance = NULL;
+
+FctStats&
+FctStats::Get()
+{
+    if (instance == NULL) {
+        instance = new FctStats;
+    }
+    return *instance;
+}
+
+FctStats::FctStats()
+    : _nFlows(0),
+    _nReorderedFlows(0),
+    _nReorderedPkts(0),
+    _reorderDepth(1.0, 24, 8),
+    _record_file(NULL)
+{
+    // Short flows (see conga::SMALL_FLOW_THRESHOLD), medium, large, elephants.
+    vector<uint64_t> bounds = {100 * 1024, 1000000, 10000000};
+    setSizeBuckets(bounds);
+}
+
+void
+FctStats::setSizeBuckets(const vector<uint64_t> &bounds)
+{
+    assert(_nFlows == 0);
+
+    _bounds = bounds;
+    _buckets.assign(_bounds.size() + 1, SizeBucket());
+}
+
+void
+FctStats::setRecordFile(const string &filename)
+{
+    close();
+
+    _record_file = fopen(filename.c_str(), "wb");
+    if (_record_file == NULL) {
+        cerr << "Failed to open FCT record file " << filename << endl;
+        exit(1);
+    }
+    setvbuf(_record_file, NULL, _IOFBF, RECORD_FILE_BUFFER);
+}
+
+simtime_picosec
+FctStats::idealFct(route_t &fwd,
+                   route_t &rev,
+                   uint64_t flowsize)
+{
+    uint64_t firstPkt = min(flowsize, (uint64_t)MSS_BYTES);
+    linkspeed_bps bottleneck = 0;
+    simtime_picosec ideal = 0;
+
+    // First packet is stored and forwarded at every hop, the rest of the
+    // flow is pipelined behind it at the bottleneck rate.
+    for (auto hop : fwd) {
+        if (Queue *q = dynamic_cast<Queue*>(hop)) {
+            ideal += timeFromSec(firstPkt * 8.0 / q->bitrate());
+            if (bottleneck == 0 || q->bitrate() < bottleneck) {
+                bottleneck = q->bitrate();
+            }
+        } else if (Pipe *p = dynamic_cast<Pipe*>(hop)) {
+            ideal += p->delay();
+        }
+    }
+
+    if (bottleneck > 0) {
+        ideal += timeFromSec((flowsize - firstPkt) * 8.0 / bottleneck);
+    }
+
+    // The last ack travels back on the reverse route.
+    for (auto hop : rev) {
+        if (Queue *q = dynamic_cast<Queue*>(hop)) {
+            ideal += timeFromSec(ACK_SIZE * 8.0 / q->bitrate());
+        } else if (Pipe *p = dynamic_cast<Pipe*>(hop)) {
+            ideal += p->delay();
+        }
+    }
+
+    return ideal;
+}
+
+void
+FctStats::recordFlow(DataSource &src,
+                     simtime_picosec finish)
+{
+    simtime_picosec fct = finish - src._start_time;
+    simtime_picosec ideal = idealFct(*src._route_fwd, *src._route_rev, src._flowsize);
+
+    uint32_t b = lower_bound(_bounds.begin(), _bounds.end(), src._flowsize) - _bounds.begin();
+    _buckets[b].fct.add(timeAsUs(fct));
+    if (ideal > 0) {
+        _buckets[b].slowdown.add((double)fct / ideal);
+    }
+    _nFlows++;
+
+    const ReorderBuffer &rb = src._sink->_received;
+    if (rb._nReordered > 0) {
+        _nReorderedFlows++;
+        _nReorderedPkts += rb._nReordered;
+        _reorderDepth.add((double)rb._maxDepth / MSS_BYTES);
+    }
+
+    if (_record_file) {
+        FlowRecord r;
+        r.id = src.id;
+        r.src = src._node_id;
+        r.dst = src._sink->_node_id;
+        r.size = src._flowsize;
+        r.start = timeAsUs(src._start_time);
+        r.fct = timeAsUs(fct);
+        r.idealFct = timeAsUs(ideal);
+        fwrite(&r, sizeof(r), 1, _record_file);
+    }
+}
+
+void
+FctStats::recordCompletion(const string &kind,
+                           simtime_picosec time)
+{
+    auto it = _completions.find(kind);
+    if (it == _completions.end()) {
+        it = _completions.insert(make_pair(kind, LogHistogram(0.01))).first;
+    }
+    it->second.add(timeAsUs(time));
+}
+
+void
+FctStats::printSummary(ostream &out)
+{
+    if (_nFlows == 0) {
+        return;
+    }
+
+    out << "FCT summary: " << _nFlows << " flows" << '\n';
+
+    for (uint32_t b = 0; b < _buckets.size(); b++) {
+        const LogHistogram &fct = _buckets[b].fct;
+        const LogHistogram &sd = _buckets[b].slowdown;
+
+        if (fct.count() == 0) {
+            continue;
+        }
+
+        out << setprecision(6) << "FCT size " << bucketLabel(b)
+            << " flows " << fct.count()
+            << " mean " << fct.mean()
+            << " p50 " << fct.percentile(0.50)
+            << " p99 " << fct.percentile(0.99)
+            << " p999 " << fct.percentile(0.999)
+            << " slowdown mean " << sd.mean()
+            << " p50 " << sd.percentile(0.50)
+            << " p99 " << sd.percentile(0.99)
+            << " p999 " << sd.percentile(0.999) << '\n';
+    }
+
+    for (auto &c : _completions) {
+        const LogHistogram &h = c.second;
+        out << setprecision(6) << c.first
+            << " n " << h.count()
+            << " mean " << h.mean()
+            << " p50 " << h.percentile(0.50)
+            << " p90 " << h.percentile(0.90)
+            << " p99 " << h.percentile(0.99)
+            << " p999 " << h.percentile(0.999)
+            << " max " << h.max() << '\n';
+    }
+
+    out << "Reorder flows " << _nReorderedFlows
+        << " pkts " << _nReorderedPkts
+        << " depth mean " << _reorderDepth.mean()
+        << " p50 " << _reorderDepth.percentile(0.50)
+        << " p99 " << _reorderDepth.percentile(0.99)
+        << " max " << _reorderDepth.max() << '\n';
+}
+
+string
+FctStats::bucketLabel(uint32_t b) const
+{
+    return (b < _bounds.size()) ? "<=" + to_string(_bounds[b])
+                                : ">" + to_string(_bounds.back());
+}
+
+void
+FctStats::close()
+{
+    if (_record_file != NULL) {
+        fclose(_record_file);
+        _record_file = NULL;
+    }
+}
@@ -0,0 +1,131 @@
+/*
+ * Flow completion time statistics header
+ */
+#ifndef FCT_STATS_H
+#define FCT_STATS_H
+
+#include "htsim.h"
+#include "network.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+class DataSource;
+
+/*
+ * A streaming histogram with logarithmically spaced buckets. Every octave
+ * above minValue is split into a fixed number of sub-buckets, so the
+ * relative error of a percentile is bounded by 2^(1/subBuckets) - 1 while
+ * memory stays constant regardless of how many samples are added.
+ */
+class LogHistogram
+{
+    public:
+        LogHistogram(double minValue = 1.0, uint32_t octaves = 40, uint32_t subBuckets = 32);
+
+        void add(double value);
+        void clear();
+
+        uint64_t count() const { return _count; }
+        double mean() const { return _count ? _sum / _count : 0.0; }
+        double max() const { return _max; }
+
+        // Returns the value below which a fraction p (0..1) of samples fall.
+        double percentile(double p) const;
+
+    private:
+        double _minValue;
+        uint32_t _subBuckets;
+        std::vector<uint64_t> _buckets;
+
+        uint64_t _count;
+        double _sum;
+        double _max;
+};
+
+/*
+ * Collects flow completion times from all DataSource endhosts. FCTs and
+ * slowdowns (FCT over the ideal FCT on an empty path) are kept in one
+ * LogHistogram pair per flow-size bucket, so memory is bounded and nothing
+ * is flushed per flow. The receiver's reorder statistics are folded in when
+ * the flow finishes. Optionally, a binary record per flow is appended to
+ * a buffered file for offline analysis.
+ */
+class FctStats
+{
+    public:
+        // Returns the collector instance.
+        static FctStats& Get();
+
+        // Upper flow-size bounds of each bucket (bytes), ascending.
+        void setSizeBuckets(const std::vector<uint64_t> &bounds);
+
+        // Write one FlowRecord per completed flow to the given file.
+        void setRecordFile(const std::string &filename);
+
+        // Record a finished flow; called by the source when its last byte is acked.
+        void recordFlow(DataSource &src, simtime_picosec finish);
+
+        // Record the completion time of a group of flows of the given kind
+        // ("QCT" for an incast query, ...), from its first start to its last
+        // finish.
+        void recordCompletion(const std::string &kind, simtime_picosec time);
+
+        // Ideal FCT of a flow over an otherwise empty forward/reverse route.
+        static simtime_picosec idealFct(route_t &fwd, route_t &rev, uint64_t flowsize);
+
+        // Print a compact per-bucket summary.
+        void printSummary(std::ostream &out);
+
+        // Flow-size buckets, their labels ("<=bound", ">bound") and FCTs (us).
+        uint32_t nBuckets() const { return _buckets.size(); }
+        std::string bucketLabel(uint32_t b) const;
+        const LogHistogram& fctHistogram(uint32_t b) const { return _buckets[b].fct; }
+
+        // Flush and close the record file, if any.
+        void close();
+
+        uint64_t _nFlows;
+
+        // Flows that saw reordering, their out-of-order segments and the
+        // per-flow maximum reorder depth in segments.
+        uint64_t _nReorderedFlows;
+        uint64_t _nReorderedPkts;
+        LogHistogram _reorderDepth;
+
+        struct __attribute__((__packed__)) FlowRecord {
+            uint32_t id;
+            uint32_t src;
+            uint32_t dst;
+            uint64_t size;
+            double   start;    // us
+            double   fct;      // us
+            double   idealFct; // us
+        };
+
+    private:
+        FctStats();
+        ~FctStats(){};
+        FctStats(const FctStats&);
+        FctStats& operator=(const FctStats&);
+
+        static FctStats *instance;
+
+        struct SizeBucket {
+            SizeBucket() : fct(0.01), slowdown(1.0, 24) {}
+
+            LogHistogram fct;      // us
+            LogHistogram slowdown; // fct / ideal fct
+        };
+
+        std::vector<uint64_t> _bounds;
+        std::vector<SizeBucket> _buckets;
+
+        // Completion times (us) of groups of flows, by kind.
+        std::map<std::string,LogHistogram> _completions;
+
+        FILE *_record_file;
+};
+
+#endif /* FCT_STATS_H */
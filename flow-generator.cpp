@@ -2,9 +2,12 @@
  * Flow generator
  */
 #include "flow-generator.h"
+#include "output.h"
 
 using namespace std;
 
+FlowTraceWriter *FlowGenerator::_saveTrace = NULL;
+
 FlowGenerator::FlowGenerator(DataSource::EndHost endhost, 
                              route_gen_t rg,
                              linkspeed_bps flowRate, 
@@ -18,14 +21,21 @@ FlowGenerator::FlowGenerator(DataSource::EndHost endhost,
     _flowSizeDist(flowSizeDist),
     _flowsGenerated(0),
     _workload(avgFlowSize, flowSizeDist),
+    _rng(Rng::nameFor("flowgen")),
+    _startJitter(timeFromUs(5)),
+    _fluid(false),
+    _class(0),
+    _tm(NULL),
     _endhostQ(false),
     _useTrace(false),
     _replaceFlow(false),
     _maxFlows(0),
     _concurrentFlows(0),
     _avgOffTime(0),
-    _flowTrace(),
-    _liveFlows()
+    _isBinaryTrace(false),
+    _liveFlows(),
+    _nGroups(0),
+    _nGroupsDone(0)
 {
     double flowsPerSec = _flowRate / (_workload._avgFlowSize * 8.0);
     _avgFlowArrivalTime = timeFromSec(1) / flowsPerSec;
@@ -36,7 +46,9 @@ FlowGenerator::setTimeLimits(simtime_picosec startTime,
                              simtime_picosec endTime)
 {
     if (_useTrace) {
-        EventList::Get().sourceIsPending(*this, _flowTrace.front().first);
+        if (!traceDone()) {
+            EventList::Get().sourceIsPending(*this, traceFront().arrival);
+        }
     } else {
         EventList::Get().sourceIsPending(*this, startTime);
     }
@@ -66,35 +78,98 @@ FlowGenerator::setReplaceFlow(uint32_t maxFlows,
     _avgOffTime = llround(timeFromSec(avgFCT) * offRatio / (1 + offRatio));
 }
 
+void
+FlowGenerator::setSubflowRoutes(subflow_route_gen_t rg)
+{
+    _subflowRouteGen = rg;
+}
+
 void
 FlowGenerator::setPrefix(string prefix)
 {
     _prefix = prefix;
+
+    // Named now, so draw from streams of that name.
+    _rng = Rng(Rng::claim("flowgen/" + prefix));
+    _workload._rng = Rng(Rng::claim("workload/" + prefix));
+}
+
+void
+FlowGenerator::setFluid(bool fluid)
+{
+    _fluid = fluid;
 }
 
 void
-FlowGenerator::setTrace(string filename)
+FlowGenerator::setTrace(string filename,
+                        uint32_t cls)
 {
     _useTrace = true;
 
+    if (FlowTrace::isBinary(filename)) {
+        _isBinaryTrace = true;
+        _binaryTrace.open(filename, cls);
+        return;
+    }
+
     FILE *fp = fopen(filename.c_str(), "r");
     if (fp == NULL) {
         fprintf(stderr, "Error opening trace file: %s\n", filename.c_str());
         exit(1);
     }
 
-    uint32_t fid;
-    uint32_t fsize;
-    uint64_t fstart;
-
-    /* Assumes the file is sorted by flow arrival. */
-    while (fscanf(fp, "flow-%u %lu %*lu %u %*lu %*lu ", &fid, &fstart, &fsize) != EOF) {
-        _flowTrace.push_back(make_pair(timeFromUs(fstart), fsize));
+    /* Flow start lines: <name> <start us> <id> <size> <src> <dst>.
+     * Assumes the file is sorted by flow arrival. */
+    double fstart;
+    FlowTraceEntry entry = {};
+    while (fscanf(fp, "%*s %lf %*u %lu %u %u ", &fstart, &entry.size, &entry.src, &entry.dst) == 4) {
+        entry.arrival = timeFromUs(fstart);
+        _textTrace.push_back(entry);
     }
 
     fclose(fp);
 }
 
+void
+FlowGenerator::setTrafficMatrix(TrafficMatrix *tm)
+{
+    _tm = tm;
+}
+
+void
+FlowGenerator::setClass(uint32_t cls)
+{
+    _class = cls;
+}
+
+void
+FlowGenerator::setStartJitter(simtime_picosec jitter)
+{
+    _startJitter = jitter;
+}
+
+bool
+FlowGenerator::traceDone() const
+{
+    return _isBinaryTrace ? _binaryTrace.done() : _textTrace.empty();
+}
+
+const FlowTraceEntry&
+FlowGenerator::traceFront() const
+{
+    return _isBinaryTrace ? _binaryTrace.front() : _textTrace.front();
+}
+
+void
+FlowGenerator::tracePop()
+{
+    if (_isBinaryTrace) {
+        _binaryTrace.pop();
+    } else {
+        _textTrace.pop_front();
+    }
+}
+
 void
 FlowGenerator::doNextEvent()
 {
@@ -104,30 +179,33 @@ FlowGenerator::doNextEvent()
     }
 
     // Get flowsize from given distriubtion or trace.
-    uint64_t flowSize;
-
     if (_useTrace) {
-        flowSize = _flowTrace.front().second;
-        _flowTrace.pop_front();
+        if (traceDone()) {
+            return;
+        }
+        FlowTraceEntry entry = traceFront();
+        tracePop();
+        createFlow(entry.size, 0, entry.src, entry.dst);
+    } else if (_tm != NULL) {
+        uint32_t src, dst;
+        _tm->sample(_rng, src, dst);
+        createFlow(_workload.generateFlowSize(), 0, src, dst);
     } else {
-        flowSize = _workload.generateFlowSize();
+        createFlow(_workload.generateFlowSize(), 0);
     }
-
-    // Create the flow.
-    createFlow(flowSize, 0);
     _concurrentFlows++;
 
     // Get next flow arrival from given distriubtion or trace.
     simtime_picosec nextFlowArrival;
 
     if (_useTrace) {
-        if (_flowTrace.size() > 0) {
-            nextFlowArrival = _flowTrace.front().first - EventList::Get().now();
-        } else {
+        if (traceDone()) {
             return;
         }
+        // Out-of-order arrivals go at once.
+        nextFlowArrival = max(traceFront().arrival, EventList::Get().now()) - EventList::Get().now();
     } else {
-        nextFlowArrival = exponential(1.0/_avgFlowArrivalTime);
+        nextFlowArrival = _rng.exponential(1.0/_avgFlowArrivalTime);
     }
 
     // Schedule next flow.
@@ -136,18 +214,30 @@ FlowGenerator::doNextEvent()
     }
 }
 
-void
+uint32_t
 FlowGenerator::createFlow(uint64_t flowSize, 
-                          simtime_picosec startTime)
+                          simtime_picosec startTime,
+                          uint32_t srcNode,
+                          uint32_t dstNode)
 {
-    // Generate a random route.
+    // Generate a route, random unless the nodes are given.
     route_t *routeFwd = NULL, *routeRev = NULL;
     TCPFlow *flow = NULL;
-    uint32_t src_node = 0, dst_node = 0;
+    uint32_t src_node = srcNode, dst_node = dstNode;
     _routeGen(routeFwd, routeRev, src_node, dst_node);
 
+    if (_saveTrace != NULL) {
+        FlowTraceEntry entry = {};
+        entry.arrival = EventList::Get().now() + startTime;
+        entry.size = flowSize;
+        entry.src = src_node;
+        entry.dst = dst_node;
+        entry.cls = _class;
+        _saveTrace->append(entry);
+    }
+
     // Generate next start time adding jitter.
-    simtime_picosec start_time = EventList::Get().now() + startTime + llround(drand() * timeFromUs(5));
+    simtime_picosec start_time = EventList::Get().now() + startTime + llround(_rng.uniform() * _startJitter);
     simtime_picosec deadline = timeFromSec((flowSize * 8.0) / speedFromGbps(0.8));
 
     // If flag set, append an endhost queue.
@@ -159,7 +249,11 @@ FlowGenerator::createFlow(uint64_t flowSize,
     DataSource *src;
     DataSink *snk;
 
-    switch (_endhost) {
+    // Fluid mode replaces whatever transport the testbed asked for.
+    bool fluid = FluidNetwork::_enabled || _fluid;
+    DataSource::EndHost endhost = fluid ? DataSource::FLUID : _endhost;
+
+    switch (endhost) {
         case DataSource::PKTPAIR:
             src = new PacketPairSrc(NULL, flowSize);
             snk = new PacketPairSink();
@@ -170,6 +264,43 @@ FlowGenerator::createFlow(uint64_t flowSize,
             snk = new TimelySink();
             break;
 
+        case DataSource::DCQCN:
+            src = new DcqcnSrc(NULL, flowSize);
+            snk = new RdmaSink(true);
+            break;
+
+        case DataSource::HPCC:
+            src = new HpccSrc(NULL, flowSize);
+            snk = new RdmaSink(false);
+            break;
+
+        case DataSource::SWIFT:
+            src = new SwiftSrc(NULL, flowSize);
+            snk = new SwiftSink();
+            break;
+
+        case DataSource::NDP:
+            src = new NdpSrc(NULL, flowSize);
+            snk = new NdpSink();
+            break;
+
+        case DataSource::MPTCP: {
+            MptcpSrc *mp = new MptcpSrc(NULL, flowSize);
+            for (uint32_t k = 1; _subflowRouteGen && k < MptcpSrc::_nSubflows; k++) {
+                route_t *fwd = NULL, *rev = NULL;
+                _subflowRouteGen(fwd, rev, src_node, dst_node, k);
+                mp->addSubflow(*fwd, *rev);
+            }
+            src = mp;
+            snk = new MptcpSink();
+            break;
+        }
+
+        case DataSource::FLUID:
+            src = new FluidSrc(flowSize);
+            snk = new FluidSink();
+            break;
+
         default: { // TCP variant
                      // TODO: option to supply logtcp.
                      src = new TcpSrc(NULL, NULL, flowSize);
@@ -182,6 +313,10 @@ FlowGenerator::createFlow(uint64_t flowSize,
                      if (_endhost == DataSource::D_TCP || _endhost == DataSource::D_DCTCP) {
                          src->_enable_deadline = true;
                      }
+
+                     if (_endhost == DataSource::PFABRIC) {
+                         TcpSrc::_enable_pfabric = true;
+                     }
                  }
     }
 
@@ -197,34 +332,88 @@ FlowGenerator::createFlow(uint64_t flowSize,
     src->connect(start_time, *routeFwd, *routeRev, *snk);
     src->setFlowGenerator(this);
 
+    // Packet flows hold a share of their route against fluid background.
+    if (FluidNetwork::_hybrid && !fluid) {
+        FluidNetwork::Get().addPacketFlow(*routeFwd);
+    }
+
     _liveFlows[src->id] = src;
 
     _flowsGenerated++;
+    return src->id;
 }
 
 void
 FlowGenerator::finishFlow(uint32_t flow_id)
 {
-    if (_liveFlows.erase(flow_id) == 0) {
+    auto it = _liveFlows.find(flow_id);
+    if (it == _liveFlows.end()) {
         return;
     }
 
+    if (FluidNetwork::_hybrid && !FluidNetwork::_enabled && !_fluid) {
+        FluidNetwork::Get().removePacketFlow(*it->second->_route_fwd);
+    }
+    _liveFlows.erase(it);
+
+    auto git = _flowGroup.find(flow_id);
+    if (git != _flowGroup.end()) {
+        auto group = _groups.find(git->second);
+        _flowGroup.erase(git);
+        if (--group->second.remaining == 0) {
+            simtime_picosec time = EventList::Get().now() - group->second.start;
+            uint32_t id = group->first;
+            _groups.erase(group);
+            _nGroupsDone++;
+            finishGroup(id, time);
+        }
+    }
+
     if (_replaceFlow) {
         uint64_t flowSize = _workload.generateFlowSize();
         uint64_t sleepTime = 0;
 
         if (_avgOffTime > 0) {
-            sleepTime = llround(exponential(1.0L / _avgOffTime));
+            sleepTime = llround(_rng.exponential(1.0L / _avgOffTime));
         }
 
-        createFlow(flowSize, sleepTime);
+        if (_tm != NULL) {
+            uint32_t src, dst;
+            _tm->sample(_rng, src, dst);
+            createFlow(flowSize, sleepTime, src, dst);
+        } else {
+            createFlow(flowSize, sleepTime);
+        }
     }
 }
 
+uint32_t
+FlowGenerator::newGroup()
+{
+    FlowGroup &group = _groups[_nGroups];
+    group.start = EventList::Get().now();
+    group.remaining = 0;
+    return _nGroups++;
+}
+
+void
+FlowGenerator::addToGroup(uint32_t group,
+                          uint32_t flow_id)
+{
+    _groups[group].remaining++;
+    _flowGroup[flow_id] = group;
+}
+
+void
+FlowGenerator::finishGroup(uint32_t,
+                           simtime_picosec)
+{
+}
+
 void
 FlowGenerator::dumpLiveFlows()
 {
-    cout << endl << "Live Flows: " << _liveFlows.size() << endl;
+    OUTPUT(LIVE_FLOW) << '\n' << "Live Flows: " << _liveFlows.size() << '\n';
     for (auto flow : _liveFlows) {
         DataSource *src = flow.second;
         src->printStatus();
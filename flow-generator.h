@@ -11,15 +11,28 @@
 #include "tcp.h"
 #include "packetpair.h"
 #include "timely.h"
+#include "dcqcn.h"
+#include "hpcc.h"
+#include "swift.h"
+#include "ndp.h"
+#include "mptcp.h"
+#include "fluid.h"
+#include "flow-trace.h"
+#include "traffic-matrix.h"
 #include "workloads.h"
 #include "prof.h"
 
 #include <deque>
 #include <functional>
 
-/* Route generator function. */
+/* Route generator function: routes between nodes src and dst, each
+ * picked at random if NODE_ANY, and sets them to the nodes used. */
 typedef std::function<void(route_t *&, route_t *&, uint32_t &, uint32_t &)> route_gen_t;
 
+/* Route generator for extra subflows of a multipath flow: a route between
+ * the same two nodes, over another path (subflow > 0). */
+typedef std::function<void(route_t *&, route_t *&, uint32_t, uint32_t, uint32_t)> subflow_route_gen_t;
+
 class FlowGenerator : public EventSource
 {
     public:
@@ -36,24 +49,62 @@ class FlowGenerator : public EventSource
         /* Fixes max flows in the systems and replaces them when finished. */
         void setReplaceFlow(uint32_t maxFlows, double offRatio);
 
-        /* Appends a prefix to flow names to differetiate from other generators. */
+        /* Routes MPTCP subflows after the first; without it they get one. */
+        void setSubflowRoutes(subflow_route_gen_t rg);
+
+        /* Appends a prefix to flow names to differetiate from other generators.
+         * Also names the generator's random streams. */
         void setPrefix(std::string prefix);
 
-        /* Flow arrival using a trace instead of dynamic generation during simulation. */
-        void setTrace(std::string filename);
+        /* Runs this generator's flows in the fluid model, as background to
+         * the packet-level ones of the others (hybrid simulation). */
+        void setFluid(bool fluid);
+
+        /* Flow arrival using a trace instead of dynamic generation during simulation:
+         * a binary flow trace (flow-trace.h), of which only flows of class cls are
+         * replayed, or a text one of flow start lines. Flows go between the
+         * recorded nodes. */
+        void setTrace(std::string filename, uint32_t cls = FLOW_CLASS_ANY);
+
+        /* Sends flows between pairs drawn from the traffic matrix instead of
+         * uniformly; the aggregate arrival rate stays the same. */
+        void setTrafficMatrix(TrafficMatrix *tm);
+
+        /* Class of this generator's flows in saved traces. */
+        void setClass(uint32_t cls);
+
+        /* Flows start up to this much after they are created (default 5us). */
+        void setStartJitter(simtime_picosec jitter);
+
+        /* Every generator's flows are appended here if set (--savetrace=). */
+        static FlowTraceWriter *_saveTrace;
 
         /* Used by Source to notify the Generator of flow finishing, which can then
          * (optionally) generate a new flow. */
-        void finishFlow(uint32_t flow_id);
+        virtual void finishFlow(uint32_t flow_id);
         void dumpLiveFlows();
 
         void setCongaSwitch(conga::LeafSwitch* sw) {
             _congaSwitch = sw;
         }
 
-    private:
-        // Creates a flow in the simulation.
-        void createFlow(uint64_t flowSize, simtime_picosec startTime);
+    protected:
+        // Creates a flow in the simulation, between the given nodes, and
+        // returns its id.
+        uint32_t createFlow(uint64_t flowSize, simtime_picosec startTime,
+                            uint32_t srcNode = NODE_ANY, uint32_t dstNode = NODE_ANY);
+
+        // Flows that complete as one (an incast query, a coflow): a group
+        // starts now, takes flows as they are created and finishes with the
+        // last of them, when finishGroup is called with its completion time.
+        uint32_t newGroup();
+        void addToGroup(uint32_t group, uint32_t flow_id);
+        virtual void finishGroup(uint32_t group, simtime_picosec time);
+
+        // The next flow of the trace, if any.
+        bool traceDone() const;
+        const FlowTraceEntry& traceFront() const;
+        void tracePop();
 
         // Returns a flow size according to some distribution.
         uint64_t generateFlowSize();
@@ -61,11 +112,17 @@ class FlowGenerator : public EventSource
         std::string _prefix;          // Optional prefix for flows.
         DataSource::EndHost _endhost; // Type of endhost.
         route_gen_t _routeGen;        // Function to generate a route.
+        subflow_route_gen_t _subflowRouteGen; // Extra MPTCP subflow routes (optional).
         linkspeed_bps _flowRate;      // Target flow rate in bytes/sec.
         uint32_t _flowSizeDist;       // Distribution of flow size [0/1/2] - Uniform/Exp/Pareto.
         uint32_t _flowsGenerated;     // Total number of flow generated.
         simtime_picosec _endTime;     // When to stop generating flows and dump live ones.
         Workloads _workload;          // Type of workload and characteristics.
+        Rng _rng;                     // Flow arrivals, off times and start jitter.
+        simtime_picosec _startJitter; // Max delay of a flow's start.
+        bool _fluid;                  // Fluid background flows.
+        uint32_t _class;              // Class in saved traces.
+        TrafficMatrix *_tm;           // Where flows go, if not uniform.
 
         // Endhost queue configuration.
         bool _endhostQ;
@@ -79,18 +136,28 @@ class FlowGenerator : public EventSource
         uint32_t _concurrentFlows;    // Number of concurrent flows.
         simtime_picosec _avgOffTime;  // Sleep duration as fraction of avgFCT.
 
-        // Trace of flow arrivals, if using trace generation. (arrival_time, size)
-        std::deque<std::pair<simtime_picosec, uint64_t> > _flowTrace;
+        // Trace of flow arrivals, if using trace generation: mapped if binary,
+        // read in if text.
+        FlowTrace _binaryTrace;
+        std::deque<FlowTraceEntry> _textTrace;
+        bool _isBinaryTrace;
 
         // List of live flows in the system.
         std::unordered_map<uint32_t,DataSource*> _liveFlows;
 
+        // Groups in progress, by id, and the group of each of their flows.
+        struct FlowGroup {
+            simtime_picosec start;
+            uint32_t remaining;       // Flows not finished yet.
+        };
+        std::unordered_map<uint32_t,FlowGroup> _groups;
+        std::unordered_map<uint32_t,uint32_t> _flowGroup;
+        uint32_t _nGroups;            // Groups started.
+        uint32_t _nGroupsDone;        // Groups finished.
+
         // Average flow inter-arrival time, computed using arguments.
         simtime_picosec _avgFlowArrivalTime;
 
-        // Custom flow size distribution.
-        std::map<double,uint64_t> _flowSizeCDF;
-
         // add conga switch
         conga::LeafSwitch* _congaSwitch;
 };
@@ -0,0 +1,153 @@
+/*
+ * Binary flow trace
+ */
+#include "flow-trace.h"
+
+#include <cstddef>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+#define FLOW_TRACE_RELEASE (16 << 20) // Bytes read between page releases.
+
+FlowTrace::FlowTrace()
+    : _map(NULL),
+    _mapSize(0),
+    _entries(NULL),
+    _next(NULL),
+    _end(NULL),
+    _released(NULL),
+    _cls(FLOW_CLASS_ANY)
+{
+}
+
+FlowTrace::~FlowTrace()
+{
+    if (_map != NULL) {
+        munmap(_map, _mapSize);
+    }
+}
+
+bool
+FlowTrace::isBinary(const string &filename)
+{
+    char magic[8];
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    bool binary = fread(magic, sizeof(magic), 1, fp) == 1
+                  && memcmp(magic, FLOW_TRACE_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return binary;
+}
+
+void
+FlowTrace::open(const string &filename,
+                uint32_t cls)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "Error opening trace file: %s\n", filename.c_str());
+        exit(1);
+    }
+
+    _mapSize = st.st_size;
+    _map = _mapSize > 0 ? mmap(NULL, _mapSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (_map == MAP_FAILED || _mapSize < sizeof(FlowTraceHeader)) {
+        fprintf(stderr, "Error mapping trace file: %s\n", filename.c_str());
+        exit(1);
+    }
+    madvise(_map, _mapSize, MADV_SEQUENTIAL);
+
+    const FlowTraceHeader *hdr = (const FlowTraceHeader*)_map;
+    if (memcmp(hdr->magic, FLOW_TRACE_MAGIC, sizeof(hdr->magic)) != 0
+            || hdr->version != FLOW_TRACE_VERSION
+            || hdr->entrySize != sizeof(FlowTraceEntry)
+            || sizeof(FlowTraceHeader) + hdr->nFlows * sizeof(FlowTraceEntry) > _mapSize) {
+        fprintf(stderr, "Bad trace file: %s\n", filename.c_str());
+        exit(1);
+    }
+
+    _entries = (const FlowTraceEntry*)(hdr + 1);
+    _next = _entries;
+    _end = _entries + hdr->nFlows;
+    _released = (const char*)_map;
+    _cls = cls;
+    skip();
+}
+
+void
+FlowTrace::pop()
+{
+    assert(!done());
+    _next++;
+    skip();
+
+    // Hand back the pages we are done with; they are clean, so this only
+    // drops them from our footprint.
+    const char *pos = (const char*)_next;
+    if (pos - _released >= FLOW_TRACE_RELEASE) {
+        size_t page = sysconf(_SC_PAGESIZE);
+        const char *upto = (const char*)_map + (pos - (const char*)_map) / page * page;
+        madvise((void*)_released, upto - _released, MADV_DONTNEED);
+        _released = upto;
+    }
+}
+
+void
+FlowTrace::skip()
+{
+    while (_next != _end && _cls != FLOW_CLASS_ANY && _next->cls != _cls) {
+        _next++;
+    }
+}
+
+FlowTraceWriter::FlowTraceWriter(const string &filename)
+    : _nFlows(0)
+{
+    _fp = fopen(filename.c_str(), "wb");
+    if (_fp == NULL) {
+        fprintf(stderr, "Error opening trace file: %s\n", filename.c_str());
+        exit(1);
+    }
+
+    // Count filled in on close.
+    FlowTraceHeader hdr;
+    memcpy(hdr.magic, FLOW_TRACE_MAGIC, sizeof(hdr.magic));
+    hdr.version = FLOW_TRACE_VERSION;
+    hdr.entrySize = sizeof(FlowTraceEntry);
+    hdr.nFlows = 0;
+    fwrite(&hdr, sizeof(hdr), 1, _fp);
+}
+
+FlowTraceWriter::~FlowTraceWriter()
+{
+    close();
+}
+
+void
+FlowTraceWriter::append(const FlowTraceEntry &entry)
+{
+    fwrite(&entry, sizeof(entry), 1, _fp);
+    _nFlows++;
+}
+
+void
+FlowTraceWriter::close()
+{
+    if (_fp == NULL) {
+        return;
+    }
+
+    fseek(_fp, offsetof(FlowTraceHeader, nFlows), SEEK_SET);
+    fwrite(&_nFlows, sizeof(_nFlows), 1, _fp);
+    fclose(_fp);
+    _fp = NULL;
+}
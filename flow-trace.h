@@ -0,0 +1,95 @@
+/*
+ * Binary flow trace header
+ */
+#ifndef FLOW_TRACE_H
+#define FLOW_TRACE_H
+
+#include "htsim.h"
+
+#include <string>
+
+#define FLOW_TRACE_MAGIC   "HTSFLOWS"
+#define FLOW_TRACE_VERSION 1
+#define FLOW_CLASS_ANY     UINT32_MAX
+
+/*
+ * A flow trace file: a FlowTraceHeader, then one FlowTraceEntry per flow,
+ * in order of arrival. Written by FlowTraceWriter (--savetrace=) and
+ * replayed by FlowGenerator::setTrace.
+ */
+struct __attribute__((__packed__)) FlowTraceHeader {
+    char     magic[8];      // FLOW_TRACE_MAGIC, not terminated.
+    uint32_t version;
+    uint32_t entrySize;     // sizeof(FlowTraceEntry)
+    uint64_t nFlows;
+};
+
+struct __attribute__((__packed__)) FlowTraceEntry {
+    uint64_t arrival;       // ps
+    uint64_t size;          // bytes
+    uint32_t src;           // Nodes of the testbed's route generator.
+    uint32_t dst;
+    uint32_t cls;           // Class, e.g. the generator that made it.
+    uint32_t pad;
+};
+
+/*
+ * Read-only view of a flow trace, mmapped and walked front to back. Pages
+ * are faulted in as the cursor reaches them and handed back once it is
+ * past them, so opening a trace costs nothing and replaying one takes
+ * constant memory, however many flows it holds.
+ */
+class FlowTrace
+{
+    public:
+        FlowTrace();
+        ~FlowTrace();
+
+        // Whether filename is a flow trace, as opposed to a text one.
+        static bool isBinary(const std::string &filename);
+
+        // Map the trace; only entries of class cls are seen (FLOW_CLASS_ANY:
+        // all). Exits on a missing or malformed file.
+        void open(const std::string &filename, uint32_t cls = FLOW_CLASS_ANY);
+
+        bool done() const { return _next == _end; }
+        const FlowTraceEntry& front() const { return *_next; }
+        void pop();
+
+        uint64_t nFlows() const { return _end - _entries; }
+
+    private:
+        FlowTrace(const FlowTrace&); // Copy constructor too.
+        FlowTrace& operator=(const FlowTrace&); // Assignment operator too.
+
+        // Move on to the next entry of our class.
+        void skip();
+
+        void *_map;
+        size_t _mapSize;
+        const FlowTraceEntry *_entries;
+        const FlowTraceEntry *_next;
+        const FlowTraceEntry *_end;
+        const char *_released;      // Pages before this were handed back.
+        uint32_t _cls;
+};
+
+/*
+ * Appends flows to a new trace file; the header's count is filled in on
+ * close.
+ */
+class FlowTraceWriter
+{
+    public:
+        FlowTraceWriter(const std::string &filename);
+        ~FlowTraceWriter();
+
+        void append(const FlowTraceEntry &entry);
+        void close();
+
+    private:
+        FILE *_fp;
+        uint64_t _nFlows;
+};
+
+#endif /* FLOW_TRACE_H */
@@ -0,0 +1,463 @@
+/*
+ * Fluid (flow-level) simulation
+ */
+#include "fluid.h"
+#include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+#include <algorithm>
+
+using namespace std;
+
+FluidSrc::FluidSrc(uint64_t flowsize)
+    : DataSource(NULL, flowsize, 0),
+      _state(IDLE),
+      _latency(0),
+      _slot(0)
+{
+    // Constructor
+}
+
+void
+FluidSrc::printStatus()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    uint64_t done = (_state == IDLE) ? 0 : _flowsize;
+    double rate = 0;
+
+    if (_state == NORMAL) {
+        done = _flowsize - llround(FluidNetwork::Get().remaining(*this));
+        rate = FluidNetwork::Get().rate(*this);
+    }
+
+    // bytes_transferred/total_bytes == time_elapsed/estimated_fct
+    simtime_picosec estimated_fct = 0;
+    if (done > 0) {
+        estimated_fct = _flowsize * (current_ts - _start_time) / done;
+    }
+
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << done
+         << " fct " << timeAsUs(estimated_fct)
+         << " sent " << done << " 0"
+         << " rate " << rate / 1e9 << '\n';
+}
+
+void
+FluidSrc::doNextEvent()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    if (_state == IDLE) {
+        _state = NORMAL;
+        FluidNetwork::Get().addFlow(*this);
+        return;
+    }
+
+    // The last byte left the network a path latency ago; report and cleanup.
+    assert(_state == FINISH);
+
+    _packets_sent = _highest_sent = _last_acked = _flowsize;
+    if (_flowgen != NULL) {
+        _flowgen->finishFlow(id);
+    }
+    // Hybrid background flows are not what is being measured.
+    if (FluidNetwork::_enabled) {
+        FctStats::Get().recordFlow(*this, current_ts);
+    }
+
+    OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << " " << id << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
+         << " fct " << timeAsUs(current_ts - _start_time)
+         << " sent " << _highest_sent << " " << 0
+         << " tput " << _flowsize * 8000.0 / (current_ts - _start_time) << '\n';
+
+    delete _sink;
+    delete _route_fwd;
+    delete _route_rev;
+    delete this;
+}
+
+void
+FluidSrc::receivePacket(Packet &pkt)
+{
+    // Fluid flows exchange no packets.
+    pkt.free();
+}
+
+
+FluidNetwork *FluidNetwork::instance = NULL;
+bool FluidNetwork::_enabled = false;
+simtime_picosec FluidNetwork::_quantum = timeFromUs(FLUID_QUANTUM_US);
+bool FluidNetwork::_hybrid = false;
+
+FluidNetwork&
+FluidNetwork::Get()
+{
+    if (instance == NULL) {
+        instance = new FluidNetwork();
+    }
+    return *instance;
+}
+
+FluidNetwork::FluidNetwork()
+    : EventSource("fluid"),
+    _nRecomputes(0),
+    _last(0),
+    _next_allocate(0),
+    _next_departure(ULLONG_MAX),
+    _dirty(false),
+    _armed(ULLONG_MAX)
+{}
+
+void
+FluidNetwork::addFlow(FluidSrc &src)
+{
+    // Other flows' rates stay as they are until the next allocation, so
+    // they needn't be advanced; this one drains nothing until then.
+    simtime_picosec now = EventList::Get().now();
+
+    Flow f;
+    f.remaining = src._flowsize;
+    f.rate = 0;
+    f.src = &src;
+    f.nLinks = 0;
+    f.frozen = false;
+
+    uint32_t slot = _flows.size();
+    linkspeed_bps bottleneck = 0;
+
+    for (auto hop : *src._route_fwd) {
+        Queue *q = dynamic_cast<Queue*>(hop);
+        if (q == NULL) {
+            continue;
+        }
+        assert(f.nLinks < FLUID_MAX_HOPS);
+
+        uint32_t l = linkFor(q);
+        _links[l].flows.push_back(slot);
+        f.links[f.nLinks++] = l;
+
+        if (bottleneck == 0 || q->bitrate() < bottleneck) {
+            bottleneck = q->bitrate();
+        }
+    }
+    assert(bottleneck > 0);
+
+    // What the flow takes beyond draining at its bottleneck rate: store and
+    // forward of the first packet, propagation and the last ack's return.
+    simtime_picosec ideal = FctStats::idealFct(*src._route_fwd, *src._route_rev, src._flowsize);
+    simtime_picosec drain = timeFromSec(src._flowsize * 8.0 / bottleneck);
+    src._latency = ideal > drain ? ideal - drain : 0;
+    src._slot = slot;
+    _flows.push_back(f);
+
+    _dirty = true;
+    update(now);
+}
+
+uint32_t
+FluidNetwork::linkFor(Queue *q)
+{
+    auto it = _linkIds.find(q);
+    if (it != _linkIds.end()) {
+        return it->second;
+    }
+
+    uint32_t l;
+    if (_freeLinks.empty()) {
+        l = _links.size();
+        _links.push_back(Link());
+    } else {
+        l = _freeLinks.back();
+        _freeLinks.pop_back();
+    }
+
+    Link &link = _links[l];
+    link.capacity = q->bitrate();
+    link.residual = 0;
+    link.unfrozen = 0;
+    link.queue = q;
+    link.nPacketFlows = 0;
+    link.fluidRate = 0;
+    link.loaded = 0;
+    _linkIds[q] = l;
+    return l;
+}
+
+void
+FluidNetwork::releaseLink(uint32_t l)
+{
+    Link &link = _links[l];
+    if (link.flows.empty()) {
+        link.fluidRate = 0;
+        loadQueue(link);
+        if (link.nPacketFlows == 0) {
+            _linkIds.erase(link.queue);
+            _freeLinks.push_back(l);
+        }
+    }
+}
+
+void
+FluidNetwork::loadQueue(Link &link)
+{
+    if (!_hybrid || link.fluidRate == link.loaded) {
+        return;
+    }
+    link.loaded = link.fluidRate;
+
+    // Standing queue of M/D/1 at load rho: rho^2 / 2(1 - rho) packets.
+    Queue &q = *link.queue;
+    double rho = min(link.fluidRate / link.capacity, FLUID_MAX_LOAD);
+    double backlog = MSS_BYTES * rho * rho / (2 * (1 - rho));
+    mem_b limit = ENABLE_ECN ? q.dctcpThreshold() : q._maxsize / 2;
+
+    q.setFluidLoad(rho * link.capacity, min((mem_b)backlog, limit));
+}
+
+void
+FluidNetwork::addPacketFlow(route_t &route)
+{
+    for (auto hop : route) {
+        Queue *q = dynamic_cast<Queue*>(hop);
+        if (q != NULL) {
+            _links[linkFor(q)].nPacketFlows++;
+        }
+    }
+    _dirty = true;
+    update(EventList::Get().now());
+}
+
+void
+FluidNetwork::removePacketFlow(route_t &route)
+{
+    for (auto hop : route) {
+        Queue *q = dynamic_cast<Queue*>(hop);
+        if (q == NULL) {
+            continue;
+        }
+        uint32_t l = _linkIds[q];
+        assert(_links[l].nPacketFlows > 0);
+        _links[l].nPacketFlows--;
+        releaseLink(l);
+    }
+    _dirty = true;
+    update(EventList::Get().now());
+}
+
+void
+FluidNetwork::removeFlow(uint32_t slot)
+{
+    Flow &f = _flows[slot];
+    for (uint32_t i = 0; i < f.nLinks; i++) {
+        Link &link = _links[f.links[i]];
+        for (uint32_t j = 0; j < link.flows.size(); j++) {
+            if (link.flows[j] == slot) {
+                link.flows[j] = link.flows.back();
+                link.flows.pop_back();
+                break;
+            }
+        }
+
+        // Links nobody crosses are recycled until a flow needs them again.
+        releaseLink(f.links[i]);
+    }
+
+    // Move the last flow into the hole, renumbering it on its links.
+    uint32_t last = _flows.size() - 1;
+    if (slot != last) {
+        Flow &moved = _flows[last];
+        for (uint32_t i = 0; i < moved.nLinks; i++) {
+            for (uint32_t &s : _links[moved.links[i]].flows) {
+                if (s == last) {
+                    s = slot;
+                    break;
+                }
+            }
+        }
+        moved.src->_slot = slot;
+        _flows[slot] = moved;
+    }
+    _flows.pop_back();
+}
+
+void
+FluidNetwork::doNextEvent()
+{
+    simtime_picosec now = EventList::Get().now();
+    if (now == _armed) {
+        _armed = ULLONG_MAX;
+    }
+
+    advance(now);
+
+    // Flows that have drained leave the network and finish a path latency
+    // later. Departures are batched with allocations, so a flow may have
+    // run dry a little before now; it finishes as of when it did. An early
+    // (stale) wakeup finds none and only re-arms.
+    _next_departure = ULLONG_MAX;
+    for (uint32_t i = 0; i < _flows.size(); ) {
+        Flow &f = _flows[i];
+        if (f.remaining >= FLUID_DONE_BYTES) {
+            _next_departure = min(_next_departure, departure(f, now));
+            i++;
+            continue;
+        }
+
+        // One with no rate has no departure time (ULLONG_MAX); it leaves now.
+        FluidSrc *src = f.src;
+        simtime_picosec left = departure(f, now);
+        simtime_picosec done = (left == ULLONG_MAX ? now : left) + src->_latency;
+        removeFlow(i);
+        src->_state = FluidSrc::FINISH;
+        EventList::Get().sourceIsPending(*src, max(done, now));
+        _dirty = true;
+    }
+
+    update(now);
+}
+
+void
+FluidNetwork::update(simtime_picosec now)
+{
+    if (_dirty && now >= _next_allocate) {
+        advance(now);
+        allocate();
+        _dirty = false;
+        _next_allocate = now + _quantum;
+    }
+    schedule(now);
+}
+
+void
+FluidNetwork::advance(simtime_picosec now)
+{
+    if (now <= _last) {
+        return;
+    }
+
+    double secs = timeAsSec(now - _last);
+    for (Flow &f : _flows) {
+        f.remaining -= f.rate * secs / 8;
+    }
+    _last = now;
+}
+
+void
+FluidNetwork::allocate()
+{
+    vector<FillEntry> &fill = _fill;
+    greater<FillEntry> later;
+
+    _nRecomputes++;
+    for (Flow &f : _flows) {
+        f.frozen = false;
+    }
+
+    fill.clear();
+    for (uint32_t l = 0; l < _links.size(); l++) {
+        Link &link = _links[l];
+        if (link.flows.empty()) {
+            continue;
+        }
+        link.residual = link.capacity;
+        link.unfrozen = link.flows.size() + link.nPacketFlows;
+        link.fluidRate = 0;
+        fill.push_back({link.residual / link.unfrozen, l});
+    }
+    make_heap(fill.begin(), fill.end(), later);
+
+    // Raise all rates together; the link whose share runs out first is the
+    // bottleneck of every flow on it still rising, which then stop at that
+    // share and leave it to the other links on their paths. Flows only ever
+    // stop at or below a link's share, so shares never fall: a queued share
+    // is a lower bound, and a link is only requeued when it is popped and
+    // found to have grown.
+    while (!fill.empty()) {
+        pop_heap(fill.begin(), fill.end(), later);
+        FillEntry e = fill.back();
+        fill.pop_back();
+
+        Link &bottleneck = _links[e.link];
+        if (bottleneck.unfrozen == 0) {
+            continue;
+        }
+
+        double share = bottleneck.residual / bottleneck.unfrozen;
+        if (share > e.share) {
+            fill.push_back({share, e.link});
+            push_heap(fill.begin(), fill.end(), later);
+            continue;
+        }
+
+        for (uint32_t slot : bottleneck.flows) {
+            Flow &f = _flows[slot];
+            if (f.frozen) {
+                continue;
+            }
+            f.frozen = true;
+            f.rate = share;
+
+            for (uint32_t i = 0; i < f.nLinks; i++) {
+                Link &link = _links[f.links[i]];
+                link.residual = max(0.0, link.residual - share);
+                link.unfrozen--;
+                link.fluidRate += share;
+            }
+        }
+
+        // Foreground flows only hold their share where they are.
+        bottleneck.residual = max(0.0, bottleneck.residual - share * bottleneck.nPacketFlows);
+        bottleneck.unfrozen -= bottleneck.nPacketFlows;
+    }
+
+    for (Link &link : _links) {
+        if (!link.flows.empty()) {
+            loadQueue(link);
+        }
+    }
+
+    simtime_picosec now = EventList::Get().now();
+    _next_departure = ULLONG_MAX;
+    for (const Flow &f : _flows) {
+        _next_departure = min(_next_departure, departure(f, now));
+    }
+}
+
+simtime_picosec
+FluidNetwork::departure(const Flow &f,
+                       simtime_picosec now)
+{
+    if (f.rate <= 0) {
+        return ULLONG_MAX;
+    }
+    // Departures are batched per quantum, so a flow can be overdrawn: it
+    // finished in the past.
+    double secs = f.remaining * 8.0 / f.rate;
+    if (secs < 0) {
+        return now - min(timeFromSec(-secs), now);
+    }
+    return now + max(timeFromSec(secs), (simtime_picosec)1);
+}
+
+void
+FluidNetwork::schedule(simtime_picosec now)
+{
+    // Arrivals and departures since the last allocation wait for the next,
+    // and so do departures before it.
+    simtime_picosec next;
+    if (_dirty) {
+        next = _next_allocate;
+    } else if (_next_departure == ULLONG_MAX) {
+        next = ULLONG_MAX;
+    } else {
+        next = max(max(_next_departure, _next_allocate), now);
+    }
+
+    if (next < _armed) {
+        _armed = next;
+        EventList::Get().sourceIsPending(*this, next);
+    }
+}
@@ -0,0 +1,194 @@
+/*
+ * Fluid (flow-level) simulation header
+ */
+#ifndef FLUID_H
+#define FLUID_H
+
+#include "eventlist.h"
+#include "datasource.h"
+#include "queue.h"
+
+#include <unordered_map>
+#include <vector>
+
+#define FLUID_DONE_BYTES 1.0  // A flow with less than this left has finished.
+#define FLUID_MAX_HOPS   8    // Queues on a fluid flow's forward route.
+#define FLUID_QUANTUM_US 1    // Default minimum time between rate allocations.
+#define FLUID_MAX_LOAD   0.95 // Most of a line fluid load may take from packets.
+
+/*
+ * A flow in the fluid model: no packets, just bytes drained at the rate
+ * FluidNetwork gives it. It enters the network at its start time and
+ * leaves when its last byte is through; it then finishes after the fixed
+ * latency of its path (the ideal FCT less the transfer time at the
+ * bottleneck), so an uncontended flow completes in exactly its ideal FCT.
+ */
+class FluidSrc : public DataSource
+{
+    friend class FluidNetwork;
+    public:
+        FluidSrc(uint64_t flowsize);
+
+        void printStatus();
+        void doNextEvent();
+        void receivePacket(Packet &pkt);
+
+        // Flow status.
+        enum FlowStatus {
+            IDLE,
+            NORMAL,
+            FINISH
+        } _state;
+
+    private:
+        simtime_picosec _latency;
+        uint32_t _slot;     // In FluidNetwork::_flows while NORMAL.
+};
+
+/*
+ * Fluid flows carry no packets, so the sink has nothing to do.
+ */
+class FluidSink : public DataSink
+{
+    public:
+        FluidSink() : DataSink() {}
+        void receivePacket(Packet &pkt) { pkt.free(); }
+};
+
+/*
+ * Flow-level simulation (--fluid=1). The flow generators, workloads and
+ * topologies are the same as in packet mode: every flow still gets its
+ * route, but is a FluidSrc whose links are the route's queues. Rates are
+ * the max-min fair allocation over those links, found by progressive
+ * filling, and are only recomputed when a flow arrives or leaves; between
+ * those events every flow drains at a constant rate and the next event is
+ * the earliest departure. A recompute costs O(links log links), so with
+ * many flows coming and going they are batched per _quantum: a new flow
+ * waits up to a quantum for its first rate, a freed share up to a quantum
+ * to be handed out, and departures are collected once per quantum (each
+ * still finishing when it ran dry). Queueing, losses and congestion control are not
+ * modelled, so FCTs are those of an ideal transport that shares each
+ * bottleneck fairly at once.
+ *
+ * Every recompute walks all flows in the network, so their state is kept
+ * here in flat arrays, not in the (large, scattered) FluidSrc objects.
+ *
+ * Hybrid simulation (--hybrid=1): only the generators a testbed marks
+ * (FlowGenerator::setFluid) run as fluid, as background; the others stay
+ * packet-level, as foreground. Every foreground flow holds a fair share
+ * of each queue on its route in the allocation (as if it were a fluid
+ * flow bottlenecked there), and each queue is handed the background's
+ * rate and standing queue (Queue::setFluidLoad): packets get the rest of
+ * the line, capped at FLUID_MAX_LOAD, and wait behind the standing queue,
+ * taken to be an M/D/1 queue of MSS packets at the background's load, no
+ * longer than the ECN threshold. Background FCTs are not recorded.
+ */
+class FluidNetwork : public EventSource
+{
+    public:
+        // Returns the fluid network instance.
+        static FluidNetwork& Get();
+
+        // Run flows as FluidSrcs, whatever the testbed's endhost.
+        static bool _enabled;
+
+        // Rates are reallocated at most once per quantum; arrivals and
+        // departures in between are folded into the next allocation. 0
+        // reallocates on every one, exactly.
+        static simtime_picosec _quantum;
+
+        // Fluid flows are background to packet-level ones (see above).
+        static bool _hybrid;
+
+        void addFlow(FluidSrc &src);
+
+        // A foreground flow starts or ends on a route.
+        void addPacketFlow(route_t &route);
+        void removePacketFlow(route_t &route);
+        void doNextEvent();
+
+        // Bytes left and current rate (bps) of a flow in the network.
+        double remaining(const FluidSrc &src) const {
+            const Flow &f = _flows[src._slot];
+            return f.remaining - f.rate * timeAsSec(EventList::Get().now() - _last) / 8;
+        }
+        double rate(const FluidSrc &src) const { return _flows[src._slot].rate; }
+
+        uint64_t _nRecomputes;
+
+    private:
+        FluidNetwork();
+        ~FluidNetwork(){};
+        FluidNetwork(const FluidNetwork&); // Copy constructor too.
+        FluidNetwork& operator=(const FluidNetwork&); // Assignment operator too.
+
+        static FluidNetwork *instance;
+
+        struct Flow {
+            double remaining;   // Bytes.
+            double rate;        // bps.
+            FluidSrc *src;
+            uint32_t links[FLUID_MAX_HOPS];
+            uint32_t nLinks;
+            bool frozen;        // Rate fixed in the current filling round.
+        };
+
+        // The capacity of one Queue of the topology and the flows (slots in
+        // _flows) that cross it. Links nobody crosses are recycled.
+        struct Link {
+            double capacity;
+            double residual;    // Capacity not yet given to frozen flows.
+            uint32_t unfrozen;  // Flows whose rate may still rise.
+            Queue *queue;
+            std::vector<uint32_t> flows;
+            uint32_t nPacketFlows;  // Foreground flows, if hybrid.
+            double fluidRate;       // Sum of the rates of flows.
+            double loaded;          // Last fluid rate given to queue.
+        };
+
+        // A link's fair share of what was left of it when queued.
+        struct FillEntry {
+            double share;
+            uint32_t link;
+
+            bool operator>(const FillEntry &o) const { return share > o.share; }
+        };
+
+        uint32_t linkFor(Queue *q);
+        void removeFlow(uint32_t slot);
+
+        // Hand a link's fluid load to its queue, if hybrid; recycle it once
+        // no flows cross it.
+        void loadQueue(Link &link);
+        void releaseLink(uint32_t l);
+
+        // Drain every flow at its rate up to now.
+        void advance(simtime_picosec now);
+
+        // Max-min fair rates by progressive filling.
+        void allocate();
+
+        // Reallocate if flows came or went and the quantum is up, then
+        // wake up for the earliest departure or the next allocation.
+        void update(simtime_picosec now);
+        void schedule(simtime_picosec now);
+
+        // When a flow runs dry at its current rate (ULLONG_MAX: never).
+        simtime_picosec departure(const Flow &f, simtime_picosec now);
+
+        std::vector<Flow> _flows;
+        std::vector<Link> _links;
+        std::vector<uint32_t> _freeLinks;
+        std::vector<FillEntry> _fill;   // Progressive filling heap.
+        std::unordered_map<Queue*,uint32_t> _linkIds;
+        simtime_picosec _last;
+        simtime_picosec _next_allocate;
+        simtime_picosec _next_departure;
+        bool _dirty;    // Flows came or went since the last allocation.
+
+        // Time of our earliest event on the eventlist (ULLONG_MAX: none).
+        // The eventlist can't cancel events, so later ones may fire stale.
+        simtime_picosec _armed;
+};
+
+#endif /* FLUID_H */
@@ -0,0 +1,124 @@
+/*
+ * HPCC
+ */
+#include "hpcc.h"
+
+using namespace std;
+
+simtime_picosec HpccSrc::_base_rtt = timeFromUs(10);
+
+HpccSrc::HpccSrc(TrafficLogger *pktlogger,
+                 uint64_t flowsize,
+                 simtime_picosec duration)
+    : RdmaSrc(pktlogger, flowsize, duration),
+      _u(0.0),
+      _inc_stage(0),
+      _last_update_seq(0),
+      _nHops(0)
+{
+    // Start at line rate with a BDP worth of window.
+    _w_init = _rate * timeAsSec(_base_rtt) / 8;
+    _w_c = _w_init;
+    setWindow(_w_init);
+}
+
+void
+HpccSrc::prepareData(DataPacket &pkt)
+{
+    pkt.setFlag(Packet::INT);
+}
+
+void
+HpccSrc::processAck(DataAck &ack,
+                    simtime_picosec)
+{
+    if (ack.nIntHops() == 0) {
+        return;
+    }
+
+    // The first hop is our own NIC; size the window to its rate.
+    if (_nHops == 0) {
+        _w_init = ack.intHop(0).bitrate * timeAsSec(_base_rtt) / 8;
+        _w_c = _w_init;
+        setWindow(_w_init);
+    } else {
+        double u = measureInflight(ack);
+        bool updateWc = ack.ackno() > _last_update_seq;
+
+        setWindow(computeWind(u, updateWc));
+        if (updateWc) {
+            _last_update_seq = _highest_sent;
+        }
+    }
+
+    _nHops = ack.nIntHops();
+    for (uint32_t i = 0; i < _nHops; i++) {
+        _hops[i] = ack.intHop(i);
+    }
+}
+
+double
+HpccSrc::measureInflight(DataAck &ack)
+{
+    double T = timeAsSec(_base_rtt);
+    double u = 0;
+    simtime_picosec tau = 0;
+
+    uint32_t n = min(_nHops, ack.nIntHops());
+    for (uint32_t i = 0; i < n; i++) {
+        const Packet::IntHop &cur = ack.intHop(i);
+        const Packet::IntHop &prev = _hops[i];
+
+        // Skip hops the path no longer takes, or with nothing new to say.
+        if (cur.queueId != prev.queueId || cur.ts <= prev.ts) {
+            continue;
+        }
+
+        double txRate = (cur.txBytes - prev.txBytes) * 8.0 / timeAsSec(cur.ts - prev.ts);
+        double hopU = min(cur.qlen, prev.qlen) * 8.0 / (cur.bitrate * T) + txRate / cur.bitrate;
+        if (tau == 0 || hopU > u) {
+            u = hopU;
+            tau = cur.ts - prev.ts;
+        }
+    }
+
+    if (tau == 0) {
+        return _u;
+    }
+
+    double weight = min(timeAsSec(tau) / T, 1.0);
+    _u = (1 - weight) * _u + weight * u;
+    return _u;
+}
+
+double
+HpccSrc::computeWind(double u,
+                     bool updateWc)
+{
+    double w;
+
+    if (u >= HPCC_ETA || _inc_stage >= HPCC_MAX_STAGE) {
+        // Multiplicative: aim for eta, leaving a little room to grow.
+        w = _w_c / (max(u, 0.01) / HPCC_ETA) + HPCC_W_AI;
+        w = min(max(w, (double)HPCC_W_AI), _w_init);
+        if (updateWc) {
+            _inc_stage = 0;
+            _w_c = w;
+        }
+    } else {
+        w = min(_w_c + HPCC_W_AI, _w_init);
+        if (updateWc) {
+            _inc_stage++;
+            _w_c = w;
+        }
+    }
+
+    return w;
+}
+
+void
+HpccSrc::setWindow(double w)
+{
+    _window = llround(w);
+    _rate = llround(w * 8 / timeAsSec(_base_rtt));
+}
@@ -0,0 +1,52 @@
+/*
+ * HPCC header
+ */
+#ifndef HPCC_H
+#define HPCC_H
+
+#include "rdma.h"
+
+#define HPCC_ETA       0.95 // Target link utilization.
+#define HPCC_MAX_STAGE 5    // Additive steps before a multiplicative update.
+#define HPCC_W_AI      80   // Additive increase, in bytes.
+
+/*
+ * HPCC (Li et al., SIGCOMM 2019). Data packets ask every queue on the path
+ * for in-band telemetry (queue length, bytes sent, timestamp, link rate),
+ * which the sink echoes on its ack. From two consecutive records per hop
+ * the sender works out each link's normalized inflight bytes, keeps an
+ * EWMA U of the most loaded one and sets the window to hit HPCC_ETA:
+ * W = Wc / (U / eta) + W_AI, updating the reference window Wc once per RTT.
+ * Packets are paced at W / T, where T is the base RTT (_base_rtt).
+ */
+class HpccSrc : public RdmaSrc
+{
+    public:
+        HpccSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+                simtime_picosec duration = 0);
+
+        // Base RTT T, shared by every flow.
+        static simtime_picosec _base_rtt;
+
+        double _u;      // Normalized inflight bytes of the bottleneck.
+        double _w_c;    // Reference window.
+
+    protected:
+        void processAck(DataAck &ack, simtime_picosec now);
+        void prepareData(DataPacket &pkt);
+
+    private:
+        double measureInflight(DataAck &ack);
+        double computeWind(double u, bool updateWc);
+        void setWindow(double w);
+
+        double _w_init;             // Line rate * T; also the largest window.
+        uint32_t _inc_stage;
+        uint64_t _last_update_seq;
+
+        // Telemetry from the previous ack.
+        uint32_t _nHops;
+        Packet::IntHop _hops[MAX_INT_HOPS];
+};
+
+#endif /* HPCC_H */
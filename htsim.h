@@ -40,32 +40,6 @@ typedef uint32_t addr_t;
 typedef uint16_t port_t;
 
 
-/* Random generators. */
-inline double 
-drand()
-{
-    int r = rand();
-    int m = RAND_MAX;
-    double d = (double)r/(double)m;
-    return d;
-}
-
-inline int 
-pareto(double alpha, int mean)
-{
-    // alpha is also called 'shape'
-    double scale = (mean * (alpha - 1)) / alpha;
-    return (int)(scale / pow(drand(), 1/alpha));
-}
-
-inline double 
-exponential(double lambda)
-{
-    // mean is 1/lambda
-    return -log(drand())/lambda;
-}
-
-
 /* Time conversions. */
 inline simtime_picosec 
 timeFromSec(double secs)
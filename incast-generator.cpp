@@ -0,0 +1,69 @@
+/*
+ * Incast generator
+ */
+#include "incast-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+using namespace std;
+
+IncastGenerator::IncastGenerator(DataSource::EndHost endhost,
+                                 route_gen_t rg,
+                                 uint32_t nHosts,
+                                 uint32_t fanIn,
+                                 uint64_t responseSize,
+                                 simtime_picosec period)
+    : FlowGenerator(endhost, rg, fanIn * responseSize * 8.0 / timeAsSec(period),
+                    responseSize, Workloads::UNIFORM),
+    _fanIn(fanIn),
+    _responseSize(responseSize),
+    _period(period),
+    _hosts(nHosts)
+{
+    if (fanIn == 0 || fanIn >= nHosts) {
+        fprintf(stderr, "Incast fan-in %u needs 1 to %u senders\n", fanIn, nHosts - 1);
+        exit(1);
+    }
+
+    for (uint32_t i = 0; i < nHosts; i++) {
+        _hosts[i] = i;
+    }
+    setStartJitter(0);
+}
+
+void
+IncastGenerator::doNextEvent()
+{
+    if (EventList::Get().now() == _endTime) {
+        OUTPUT(SUMMARY) << "Incast queries " << _nGroups << " completed " << _nGroupsDone
+                        << " fan-in " << _fanIn << " response " << _responseSize << '\n';
+        dumpLiveFlows();
+        return;
+    }
+
+    startQuery();
+    EventList::Get().sourceIsPendingRel(*this, _period);
+}
+
+void
+IncastGenerator::startQuery()
+{
+    // The first fanIn + 1 hosts of a partial shuffle: the aggregator, then
+    // the senders.
+    uint32_t n = _hosts.size();
+    for (uint32_t i = 0; i <= _fanIn; i++) {
+        swap(_hosts[i], _hosts[i + _rng.below(n - i)]);
+    }
+
+    uint32_t query = newGroup();
+    for (uint32_t i = 1; i <= _fanIn; i++) {
+        addToGroup(query, createFlow(_responseSize, 0, _hosts[i], _hosts[0]));
+    }
+}
+
+void
+IncastGenerator::finishGroup(uint32_t,
+                             simtime_picosec time)
+{
+    FctStats::Get().recordCompletion("QCT", time);
+}
@@ -0,0 +1,39 @@
+/*
+ * Incast generator header
+ */
+#ifndef INCAST_GENERATOR_H
+#define INCAST_GENERATOR_H
+
+#include "flow-generator.h"
+
+#include <vector>
+
+/*
+ * Partition-aggregate traffic: every period an aggregator, picked at
+ * random, queries fanIn other hosts at once and each responds with a
+ * responseSize flow to it. The query completes when the last response
+ * does; its completion time (QCT) goes to FctStats, the responses' FCTs
+ * as any other flow's. Responses start together unless a start jitter is
+ * set (setStartJitter).
+ */
+class IncastGenerator : public FlowGenerator
+{
+    public:
+        IncastGenerator(DataSource::EndHost endhost, route_gen_t rg, uint32_t nHosts,
+                uint32_t fanIn, uint64_t responseSize, simtime_picosec period);
+        void doNextEvent();
+
+    private:
+        // Starts a query: fanIn responses to one aggregator.
+        void startQuery();
+        void finishGroup(uint32_t group, simtime_picosec time);
+
+        uint32_t _fanIn;
+        uint64_t _responseSize;
+        simtime_picosec _period;
+
+        // Hosts, shuffled in place to pick the aggregator and senders.
+        std::vector<uint32_t> _hosts;
+};
+
+#endif /* INCAST_GENERATOR_H */
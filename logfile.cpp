@@ -100,3 +100,35 @@ Logfile::writeRecord(uint32_t type,
         _nRecords = 0;
     }
 }
+
+void
+Logfile::writeRecords(struct Record *records,
+                      uint32_t n)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    if (current_ts < _start || current_ts > _end) {
+        return;
+    }
+
+    double time = timeAsSec(current_ts);
+    for (uint32_t i = 0; i < n; i++) {
+        records[i].time = time;
+    }
+
+    _nTotalRecords += n;
+
+    while (n > 0) {
+        uint32_t count = min(n, (uint32_t)(MAX_RECORDS - _nRecords));
+        memcpy(&_records[_nRecords], records, count * sizeof(struct Record));
+
+        _nRecords += count;
+        records += count;
+        n -= count;
+
+        // Flush to file if buffer full.
+        if (_nRecords == MAX_RECORDS) {
+            fwrite(_records, sizeof(struct Record), MAX_RECORDS, _trace_file);
+            _nRecords = 0;
+        }
+    }
+}
@@ -51,6 +51,9 @@ class Logfile
         void writeRecord(uint32_t type, uint32_t id, uint32_t ev,
                 double val1, double val2, double val3);
 
+        // Appends a block of records stamped with the current time.
+        void writeRecords(struct Record *records, uint32_t n);
+
     private:
         FILE *_trace_file;
         FILE *_id_file;
@@ -3,6 +3,7 @@
  */
 #include "loggers.h"
 #include "prof.h"
+#include "output.h"
 
 using namespace std;
 
@@ -58,7 +59,9 @@ QueueLoggerSampling::doNextEvent()
     _logfile->writeRecord(QUEUE_RECORD, _queue->id, CUM_TRAFFIC, _cumarr, _cumidle, _cumdrop);
 
 #if MING_PROF
-    _queue->printStats();
+    if (Output::enabled(Output::QUEUE_STATS)) {
+        _queue->printStats(Output::Get().stream());
+    }
 #endif
 }
 
@@ -127,6 +130,167 @@ QueueLoggerSampling::logQueue(Queue& queue,
 }
 
 
+MultiQueueLoggerSampling::QueueStats::QueueStats()
+    : queue(NULL),
+    lastlook(0),
+    lastq(0),
+    seenQueueInD(false),
+    minQueueInD(0),
+    maxQueueInD(0),
+    lastDroppedInD(0),
+    lastIdledInD(0),
+    cumidle(0),
+    cumarr(0),
+    cumdrop(0),
+    bytesInD(0)
+{}
+
+MultiQueueLoggerSampling::MultiQueueLoggerSampling(simtime_picosec period)
+    : EventSource("MultiQueueLogSampling"),
+    _period(period)
+{
+    EventList::Get().sourceIsPendingRel(*this, 0);
+}
+
+MultiQueueLoggerSampling::~MultiQueueLoggerSampling()
+{
+    for (auto slot : _slots) {
+        delete slot;
+    }
+}
+
+QueueLogger *
+MultiQueueLoggerSampling::addQueue()
+{
+    _stats.push_back(QueueStats());
+    _slots.push_back(new Slot(this, _slots.size()));
+    return _slots.back();
+}
+
+void
+MultiQueueLoggerSampling::doNextEvent()
+{
+    EventList::Get().sourceIsPendingRel(*this, _period);
+
+    simtime_picosec now = EventList::Get().now();
+    double period = timeAsSec(_period);
+
+    _records.resize(3 * _stats.size());
+    uint32_t n = 0;
+
+#if MING_PROF
+    bool printStats = Output::enabled(Output::QUEUE_STATS);
+#endif
+
+    for (auto &s : _stats) {
+        if (s.queue == NULL) {
+            continue;
+        }
+
+        struct Record *r = &_records[n];
+        n += 3;
+
+        r[0].type = QueueLogger::QUEUE_APPROX;
+        r[0].id   = s.queue->id;
+        r[0].ev   = QueueLogger::QUEUE_RANGE;
+        r[1].type = QueueLogger::QUEUE_APPROX;
+        r[1].id   = s.queue->id;
+        r[1].ev   = QueueLogger::QUEUE_OVERFLOW;
+
+        if (!s.seenQueueInD) { // queue size hasn't changed in the past D time units
+            r[0].val1 = r[0].val2 = r[0].val3 = (double)s.lastq;
+            r[1].val1 = 0;
+            r[1].val2 = 0;
+        } else { // queue size has changed
+            r[0].val1 = (double)s.lastq;
+            r[0].val2 = (double)s.minQueueInD;
+            r[0].val3 = (double)s.maxQueueInD;
+            r[1].val1 = -(double)s.lastIdledInD;
+            r[1].val2 = (double)s.lastDroppedInD;
+        }
+        r[1].val3 = s.bytesInD / period;
+
+        s.seenQueueInD = false;
+        simtime_picosec dt_ps = now - s.lastlook;
+        s.lastlook = now;
+        s.bytesInD = 0;
+
+        // if the queue is empty, we've just been idling
+        if (s.queue->_queuesize == 0) {
+            s.cumidle += timeAsSec(dt_ps);
+        }
+
+        r[2].type = QueueLogger::QUEUE_RECORD;
+        r[2].id   = s.queue->id;
+        r[2].ev   = QueueLogger::CUM_TRAFFIC;
+        r[2].val1 = s.cumarr;
+        r[2].val2 = s.cumidle;
+        r[2].val3 = s.cumdrop;
+
+#if MING_PROF
+        // Idle queues carry no per-flow occupancy worth reporting.
+        if (printStats && s.queue->_queuesize > 0) {
+            s.queue->printStats(Output::Get().stream());
+        }
+#endif
+    }
+
+    if (n > 0) {
+        _logfile->writeRecords(_records.data(), n);
+    }
+}
+
+void
+MultiQueueLoggerSampling::logQueue(QueueStats &s,
+                                   Queue &queue,
+                                   QueueLogger::QueueEvent ev,
+                                   Packet &pkt)
+{
+    if (s.queue == NULL) {
+        s.queue = &queue;
+    } else {
+        assert(&queue == s.queue);
+    }
+
+    s.lastq = queue._queuesize;
+
+    if (!s.seenQueueInD) {
+        s.seenQueueInD = true;
+        s.minQueueInD = queue._queuesize;
+        s.maxQueueInD = s.minQueueInD;
+        s.lastDroppedInD = 0;
+        s.lastIdledInD = 0;
+    } else {
+        s.minQueueInD = min(s.minQueueInD, queue._queuesize);
+        s.maxQueueInD = max(s.maxQueueInD, queue._queuesize);
+    }
+
+    simtime_picosec now = EventList::Get().now();
+    simtime_picosec dt_ps = now - s.lastlook;
+    s.lastlook = now;
+
+    switch (ev) {
+        case QueueLogger::PKT_SERVICE: // we've just been working
+            s.bytesInD += pkt.size();
+            break;
+        case QueueLogger::PKT_ENQUEUE:
+            s.cumarr += timeAsSec(queue.drainTime(&pkt));
+            if (queue._queuesize <= pkt.size()) { // we've just been idling
+                s.cumidle += timeAsSec(dt_ps);
+                s.lastIdledInD = queue.serviceCapacity(dt_ps);
+            }
+            break;
+        case QueueLogger::PKT_DROP: { // assume we've just been working
+            double localdroptime = timeAsSec(queue.drainTime(&pkt));
+            s.cumarr += localdroptime;
+            s.cumdrop += localdroptime;
+            s.lastDroppedInD += pkt.size();
+            break;
+        }
+    }
+}
+
+
 AggregateTcpLogger::AggregateTcpLogger(simtime_picosec period)
     : EventSource("bunchofflows"), 
     _period(period)
@@ -75,6 +75,63 @@ class QueueLoggerSampling : public Logger, public QueueLogger, public EventSourc
         bool _printed;
 };
 
+/*
+ * Samples a whole fabric of queues from one event source. Every queue gets
+ * a lightweight per-queue logger from addQueue(), whose counters live in a
+ * single contiguous vector that is swept once per period.
+ */
+class MultiQueueLoggerSampling : public Logger, public EventSource
+{
+    public:
+        MultiQueueLoggerSampling(simtime_picosec period);
+        ~MultiQueueLoggerSampling();
+
+        // Returns the logger to be handed to a new queue.
+        QueueLogger *addQueue();
+        void doNextEvent();
+
+    private:
+        struct QueueStats {
+            QueueStats();
+
+            Queue *queue;
+            simtime_picosec lastlook;
+            mem_b lastq;
+            bool seenQueueInD;
+            mem_b minQueueInD;
+            mem_b maxQueueInD;
+            mem_b lastDroppedInD;
+            mem_b lastIdledInD;
+            double cumidle;
+            double cumarr;
+            double cumdrop;
+            uint32_t bytesInD;
+        };
+
+        class Slot : public QueueLogger
+        {
+            public:
+                Slot(MultiQueueLoggerSampling *sampler, uint32_t index)
+                    : _sampler(sampler), _index(index) {}
+                void logQueue(Queue &queue, QueueEvent ev, Packet &pkt)
+                {
+                    _sampler->logQueue(_sampler->_stats[_index], queue, ev, pkt);
+                }
+            private:
+                MultiQueueLoggerSampling *_sampler;
+                uint32_t _index;
+        };
+
+        void logQueue(QueueStats &s, Queue &queue, QueueLogger::QueueEvent ev, Packet &pkt);
+
+        simtime_picosec _period;
+        std::vector<QueueStats> _stats;
+        std::vector<Slot *> _slots;
+
+        // Per-period scratch space, reused to avoid reallocation.
+        std::vector<struct Record> _records;
+};
+
 class SinkLoggerSampling : public Logger, public EventSource
 {
     public:
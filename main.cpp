@@ -3,8 +3,18 @@
  */
 #include "clock.h"
 #include "eventlist.h"
+#include "fct-stats.h"
+#include "flow-generator.h"
+#include "fluid.h"
+#include "hpcc.h"
 #include "logfile.h"
+#include "mptcp.h"
+#include "output.h"
+#include "rng.h"
+#include "swift.h"
+#include "tcp.h"
 #include "test.h"
+#include "workloads.h"
 
 using namespace std;
 
@@ -31,9 +41,19 @@ main(int argc,
         logpath = args["logfile"];
     }
 
+    // Runtime output filtering: --verbose=0..3, --output=finish,-route,...
+    uint32_t verbose = Output::LEVEL_DEBUG;
+    string outputCats;
+    if (parseInt(args, "verbose", verbose)) {
+        Output::Get().setLevel(verbose);
+    }
+    if (parseString(args, "output", outputCats)) {
+        Output::Get().setCategories(outputCats);
+    }
+
     uint32_t rngSeed = 1729;
     parseInt(args, "rngseed", rngSeed);
-    srand(rngSeed);
+    Rng::_seed = rngSeed;
 
     uint32_t expt = 0;
     parseInt(args, "expt", expt);
@@ -42,9 +62,88 @@ main(int argc,
         return 0;
     }
 
+    // SACK-based loss recovery for TCP/DCTCP endhosts.
+    uint32_t sack = 0;
+    parseInt(args, "sack", sack);
+    TcpSrc::_enable_sack = (sack != 0);
+
+    // Delayed acks on TCP sinks: ack every N segments or after a timeout.
+    uint32_t delack = 1;
+    double delackTime = timeAsUs(TcpSink::_delack_timeout);
+    parseInt(args, "delack", delack);
+    parseDouble(args, "delacktime", delackTime);
+    TcpSink::_delack_segments = max(delack, (uint32_t)1);
+    TcpSink::_delack_timeout = timeFromUs(delackTime);
+
+    // Paced transmission for TCP/DCTCP endhosts (Timely is always paced).
+    uint32_t pacing = 0;
+    parseInt(args, "pacing", pacing);
+    TcpSrc::_enable_pacing = (pacing != 0);
+
+    // Flow-level simulation: max-min fair rates instead of packets.
+    uint32_t fluid = 0;
+    parseInt(args, "fluid", fluid);
+    FluidNetwork::_enabled = (fluid != 0);
+
+    // Minimum time between fluid rate allocations, in us (0: exact).
+    double fluidQuantum = timeAsUs(FluidNetwork::_quantum);
+    parseDouble(args, "fluidquantum", fluidQuantum);
+    FluidNetwork::_quantum = timeFromUs(fluidQuantum);
+
+    // ECN marking threshold in packets, overriding the per-rate default.
+    uint32_t ecnThresh = 0;
+    parseInt(args, "ecnthresh", ecnThresh);
+    Queue::_ecn_threshold = (mem_b)ecnThresh * MSS_BYTES;
+
+    // Packets through idle queues in one event.
+    uint32_t fastForward = 0;
+    parseInt(args, "fastforward", fastForward);
+    Queue::_fast_forward = (fastForward != 0);
+
+    double ffHorizon = timeAsUs(Queue::_ff_horizon);
+    parseDouble(args, "ffhorizon", ffHorizon);
+    Queue::_ff_horizon = timeFromUs(ffHorizon);
+
+    // Hybrid simulation: testbed background traffic as fluid.
+    uint32_t hybrid = 0;
+    parseInt(args, "hybrid", hybrid);
+    FluidNetwork::_hybrid = (hybrid != 0);
+
+    // MPTCP subflows per connection.
+    parseInt(args, "subflows", MptcpSrc::_nSubflows);
+    MptcpSrc::_nSubflows = max(MptcpSrc::_nSubflows, (uint32_t)1);
+
+    // HPCC's base RTT T, in us.
+    double baseRtt = timeAsUs(HpccSrc::_base_rtt);
+    parseDouble(args, "basertt", baseRtt);
+    HpccSrc::_base_rtt = timeFromUs(baseRtt);
+
+    // Swift's base fabric target delay, in us.
+    double swiftTarget = timeAsUs(SwiftSrc::_base_target);
+    parseDouble(args, "swifttarget", swiftTarget);
+    SwiftSrc::_base_target = timeFromUs(swiftTarget);
+
+    // Flow size CDF for --flowdist=cdf, read before any generator exists.
+    string cdfFile;
+    if (parseString(args, "cdf", cdfFile)) {
+        Workloads::loadCdf(cdfFile);
+    }
+
     EventList &eventlist = EventList::Get();
     Logfile logfile(logpath);
 
+    // Optional binary per-flow FCT records.
+    string fctfile;
+    if (parseString(args, "fctfile", fctfile)) {
+        FctStats::Get().setRecordFile(fctfile);
+    }
+
+    // Optional binary trace of every flow started, for --trace= replay.
+    string savetrace;
+    if (parseString(args, "savetrace", savetrace)) {
+        FlowGenerator::_saveTrace = new FlowTraceWriter(savetrace);
+    }
+
     /* Run desired experiment. Complete list defined in <test.h> */
     if (run_experiment(expt, args, logfile)) {
         cerr << "Unknown experiment number\n";
@@ -55,6 +154,15 @@ main(int argc,
     Clock c;
     while (eventlist.doNextEvent()) {}
 
+    if (Output::enabled(Output::SUMMARY)) {
+        FctStats::Get().printSummary(Output::Get().stream());
+    }
+    FctStats::Get().close();
+    if (FlowGenerator::_saveTrace != NULL) {
+        FlowGenerator::_saveTrace->close();
+    }
+    Output::Get().flush();
+
     cerr << "\nExiting successfully!" << endl;
     return 0;
 }
@@ -0,0 +1,412 @@
+/*
+ * MPTCP
+ */
+#include "mptcp.h"
+#include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+using namespace std;
+
+uint32_t MptcpSrc::_nSubflows = MPTCP_SUBFLOWS;
+
+MptcpSubflow::MptcpSubflow(TrafficLogger *logger,
+                           route_t &fwd,
+                           route_t &rev)
+    : _flow(logger),
+      _route_fwd(&fwd),
+      _route_rev(&rev),
+      _cwnd(2 * MSS_BYTES),
+      _ssthresh(0xffffffff),
+      _highest_sent(0),
+      _last_acked(0),
+      _recover_seq(0),
+      _dupacks(0),
+      _in_recovery(false),
+      _rtt(0),
+      _rto(timeFromUs(INIT_RTO_US)),
+      _mdev(0),
+      _rto_timeout(0)
+{
+    // Constructor
+}
+
+MptcpSrc::MptcpSrc(TrafficLogger *pktlogger,
+                   uint64_t flowsize,
+                   simtime_picosec duration)
+    : DataSource(pktlogger, flowsize, duration),
+      _state(IDLE),
+      _nRetransmits(0),
+      _nTimeouts(0)
+{
+    // Constructor
+}
+
+void
+MptcpSrc::addSubflow(route_t &fwd,
+                     route_t &rev)
+{
+    _extra_routes.push_back(make_pair(&fwd, &rev));
+}
+
+void
+MptcpSrc::printStatus()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // bytes_transferred/total_bytes == time_elapsed/estimated_fct
+    simtime_picosec estimated_fct;
+    if (_last_acked > 0) {
+        estimated_fct = _flowsize * (current_ts - _start_time) / _last_acked;
+    } else {
+        estimated_fct = 0;
+    }
+
+    double cwnd = 0;
+    for (auto sf : _subflows) {
+        cwnd += sf->_cwnd;
+    }
+
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
+         << " fct " << timeAsUs(estimated_fct)
+         << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time)
+         << " subflows " << _subflows.size()
+         << " cwnd " << cwnd << '\n';
+}
+
+void
+MptcpSrc::doNextEvent()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    MptcpSink *sink = (MptcpSink*)_sink;
+
+    // A new flow: open every subflow. All but the first still need their
+    // routes to end at the sink and back here.
+    if (_state == IDLE) {
+        _state = NORMAL;
+
+        _subflows.push_back(new MptcpSubflow(NULL, *_route_fwd, *_route_rev));
+        for (auto &r : _extra_routes) {
+            r.first->push_back(_sink);
+            r.second->push_back(this);
+            _subflows.push_back(new MptcpSubflow(NULL, *r.first, *r.second));
+        }
+
+        for (auto sf : _subflows) {
+            sf->_flow.id = id;
+            sink->addSubflow(sf->_flow, *sf->_route_rev);
+        }
+        for (auto sf : _subflows) {
+            sendPackets(*sf);
+        }
+    }
+
+    // Cleanup the finished flow once no subflow has packets in flight.
+    else if (_state == FINISH) {
+        bool idle = true;
+        for (auto sf : _subflows) {
+            idle = idle && (sf->_flow._nPackets == 0);
+        }
+
+        if (idle) {
+            for (auto sf : _subflows) {
+                delete sf;
+            }
+            for (auto &r : _extra_routes) {
+                delete r.first;
+                delete r.second;
+            }
+            delete _sink;
+            delete _route_fwd;
+            delete _route_rev;
+            delete this;
+            return;
+        }
+    }
+
+    else {
+        for (auto sf : _subflows) {
+            if (sf->_rto_timeout != 0 && current_ts >= sf->_rto_timeout) {
+                retransmitTimeout(*sf, current_ts);
+            }
+        }
+    }
+
+    // Check the timers again after the shortest subflow RTT.
+    simtime_picosec next = timeFromUs(MIN_RTO_US);
+    for (auto sf : _subflows) {
+        if (sf->_rtt != 0 && sf->_rtt < next) {
+            next = sf->_rtt;
+        }
+    }
+    EventList::Get().sourceIsPendingRel(*this, next);
+}
+
+void
+MptcpSrc::receivePacket(Packet &pkt)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    DataAck *p = (DataAck*)(&pkt);
+    DataAck::seq_t seqno = p->ackno();
+    DataAck::seq_t data_ackno = p->data_ackno();
+    simtime_picosec ts = p->ts();
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+
+    MptcpSubflow *sf = NULL;
+    for (auto s : _subflows) {
+        if (&s->_flow == &pkt.flow()) {
+            sf = s;
+        }
+    }
+    p->free();
+
+    if (_state == FINISH) {
+        return;
+    }
+
+    if (data_ackno > _last_acked) {
+        _last_acked = data_ackno;
+    }
+
+    if ((_flowsize > 0 && _last_acked >= _flowsize) ||
+            (_duration > 0 && current_ts > _start_time + _duration)) {
+
+        if (_flowgen != NULL) {
+            _flowgen->finishFlow(id);
+        }
+        _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
+
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
+             << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
+             << " fct " << timeAsUs(current_ts - _start_time)
+             << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+             << " rate " << _flowsize * 8000.0 / (current_ts - _start_time)
+             << " subflows " << _subflows.size()
+             << " rtx " << _nRetransmits << '\n';
+
+        return;
+    }
+
+    updateRtt(*sf, current_ts - ts);
+
+    // New data acked on this subflow.
+    if (seqno > sf->_last_acked) {
+        uint64_t acked = seqno - sf->_last_acked;
+        sf->_dsn.erase(sf->_dsn.begin(), sf->_dsn.lower_bound(seqno));
+        sf->_last_acked = seqno;
+        sf->_dupacks = 0;
+        sf->_rto_timeout = (seqno >= sf->_highest_sent) ? 0 : current_ts + sf->_rto;
+
+        if (!sf->_in_recovery) {
+            increaseWindow(*sf, acked);
+        } else if (seqno >= sf->_recover_seq) {
+            // The whole recovery window is acked.
+            sf->_in_recovery = false;
+            sf->_cwnd = sf->_ssthresh;
+        } else {
+            // Partial ack: the next hole was lost too.
+            _nRetransmits++;
+            sendSegment(*sf, seqno, sf->_dsn[seqno]);
+        }
+
+        sendPackets(*sf);
+        return;
+    }
+
+    // Duplicate ack; three start fast retransmit, once per window.
+    if (sf->_in_recovery || sf->_highest_sent == sf->_last_acked) {
+        return;
+    }
+    if (++sf->_dupacks != 3 || sf->_last_acked < sf->_recover_seq) {
+        return;
+    }
+
+    sf->_ssthresh = max((uint64_t)(sf->_cwnd / 2), (uint64_t)(2 * MSS_BYTES));
+    sf->_cwnd = sf->_ssthresh;
+    sf->_in_recovery = true;
+    sf->_recover_seq = sf->_highest_sent;
+
+    _nRetransmits++;
+    sendSegment(*sf, sf->_last_acked, sf->_dsn[sf->_last_acked]);
+}
+
+void
+MptcpSrc::updateRtt(MptcpSubflow &sf,
+                    simtime_picosec rtt)
+{
+    if (sf._rtt > 0) {
+        uint64_t diff = (rtt > sf._rtt) ? (rtt - sf._rtt) : (sf._rtt - rtt);
+        sf._mdev = 3 * sf._mdev/4 + diff/4;
+        sf._rtt = 7 * sf._rtt/8 + rtt/8;
+    } else {
+        sf._rtt = rtt;
+        sf._mdev = rtt/2;
+    }
+
+    sf._rto = sf._rtt + 4 * sf._mdev;
+    if (sf._rto < timeFromUs(MIN_RTO_US)) {
+        sf._rto = timeFromUs(MIN_RTO_US);
+    }
+}
+
+double
+MptcpSrc::liaAlpha()
+{
+    double total = 0, best = 0, sum = 0;
+
+    for (auto sf : _subflows) {
+        total += sf->_cwnd;
+        if (sf->_rtt == 0) {
+            continue;
+        }
+        double rtt = timeAsUs(sf->_rtt);
+        best = max(best, sf->_cwnd / (rtt * rtt));
+        sum += sf->_cwnd / rtt;
+    }
+
+    if (sum == 0) {
+        return 1.0;
+    }
+    return total * best / (sum * sum);
+}
+
+void
+MptcpSrc::increaseWindow(MptcpSubflow &sf,
+                         uint64_t acked)
+{
+    // Slow start is per subflow.
+    if (sf._cwnd < sf._ssthresh) {
+        sf._cwnd += min(acked, (uint64_t)MSS_BYTES);
+        return;
+    }
+
+    double total = 0;
+    for (auto s : _subflows) {
+        total += s->_cwnd;
+    }
+
+    // Coupled congestion avoidance, capped at what uncoupled TCP would do.
+    double coupled = liaAlpha() * acked * MSS_BYTES / total;
+    double uncoupled = (double)acked * MSS_BYTES / sf._cwnd;
+    sf._cwnd += min(coupled, uncoupled);
+}
+
+void
+MptcpSrc::retransmitTimeout(MptcpSubflow &sf,
+                            simtime_picosec now)
+{
+    OUTPUT(RTO) << str() << " at " << timeAsMs(now)
+         << " RTO " << timeAsUs(sf._rto)
+         << " MDEV " << timeAsUs(sf._mdev)
+         << " RTT "<< timeAsUs(sf._rtt)
+         << " SEQ " << sf._last_acked / MSS_BYTES
+         << " CWND "<< sf._cwnd / MSS_BYTES
+         << " RTO_timeout " << timeAsMs(sf._rto_timeout) << '\n';
+
+    _nTimeouts++;
+    sf._ssthresh = max((uint64_t)(sf._cwnd / 2), (uint64_t)(2 * MSS_BYTES));
+    sf._cwnd = MSS_BYTES;
+    sf._in_recovery = false;
+    sf._dupacks = 0;
+    sf._recover_seq = sf._highest_sent;
+
+    // Go back to the first unacked segment; its data stays on this subflow.
+    sf._highest_sent = sf._last_acked;
+    sf._rto *= 2;
+    sf._rto_timeout = now + sf._rto;
+    sendPackets(sf);
+}
+
+void
+MptcpSrc::sendPackets(MptcpSubflow &sf)
+{
+    while (sf._last_acked + sf._cwnd >= sf._highest_sent + MSS_BYTES) {
+        uint64_t dsn;
+
+        // Resend what this subflow already carried, else take new data.
+        auto it = sf._dsn.find(sf._highest_sent);
+        if (it != sf._dsn.end()) {
+            dsn = it->second;
+            _nRetransmits++;
+        } else if (_flowsize == 0 || _highest_sent < _flowsize) {
+            dsn = _highest_sent;
+            _highest_sent += MSS_BYTES;
+            sf._dsn[sf._highest_sent] = dsn;
+        } else {
+            return;
+        }
+
+        sendSegment(sf, sf._highest_sent, dsn);
+        sf._highest_sent += MSS_BYTES;
+    }
+}
+
+void
+MptcpSrc::sendSegment(MptcpSubflow &sf,
+                      uint64_t seq,
+                      uint64_t dsn)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    DataPacket *p = DataPacket::newpkt(sf._flow, *sf._route_fwd, seq + 1, MSS_BYTES);
+    p->set_dsn(dsn + 1);
+    p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
+    p->set_ts(current_ts);
+
+    _packets_sent += MSS_BYTES;
+    p->sendOn();
+
+    if (sf._rto_timeout == 0) {
+        sf._rto_timeout = current_ts + sf._rto;
+    }
+}
+
+
+MptcpSink::MptcpSink()
+    : DataSink()
+{}
+
+void
+MptcpSink::addSubflow(PacketFlow &flow,
+                      route_t &route)
+{
+    Subflow sf;
+    sf.flow = &flow;
+    sf.route = &route;
+    sf.cumulative_ack = 0;
+    _subflows.push_back(sf);
+}
+
+void
+MptcpSink::receivePacket(Packet &pkt)
+{
+    DataPacket *p = (DataPacket*)(&pkt);
+
+    Subflow *sf = NULL;
+    for (auto &s : _subflows) {
+        if (s.flow == &pkt.flow()) {
+            sf = &s;
+        }
+    }
+
+    if (!p->getFlag(Packet::TRIMMED)) {
+        addSegment(sf->cumulative_ack, sf->received, p->seqno(), p->size());
+        addSegment(_cumulative_ack, _received, p->dsn(), p->size());
+    }
+
+    DataAck *ack = DataAck::newpkt(*sf->flow, *sf->route, 1, sf->cumulative_ack);
+    ack->setFlag(Packet::ACK);
+    ack->set_data_ackno(_cumulative_ack);
+    ack->conga_info = p->conga_info;
+    ack->set_ts(p->ts());
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+    p->free();
+
+    ack->flow().logTraffic(*ack, *this, TrafficLogger::PKT_CREATESEND);
+    ack->sendOn();
+}
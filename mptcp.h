@@ -0,0 +1,125 @@
+/*
+ * MPTCP header
+ */
+#ifndef MPTCP_H
+#define MPTCP_H
+
+#include "eventlist.h"
+#include "datasource.h"
+
+#include <map>
+#include <vector>
+
+#define MPTCP_SUBFLOWS 4  // Default number of subflows per connection.
+
+class MptcpSink;
+
+/*
+ * One subflow of an MPTCP connection: a TCP NewReno-style sender with its
+ * own path, sequence space, window and RTO, carrying MSS chunks of the
+ * connection's data. Packets belong to the subflow's own PacketFlow.
+ */
+class MptcpSubflow
+{
+    public:
+        MptcpSubflow(TrafficLogger *logger, route_t &fwd, route_t &rev);
+
+        PacketFlow _flow;
+        route_t *_route_fwd;
+        route_t *_route_rev;
+
+        double _cwnd;           // Bytes.
+        uint64_t _ssthresh;
+        uint64_t _highest_sent; // Subflow sequence space.
+        uint64_t _last_acked;
+        uint64_t _recover_seq;
+        uint16_t _dupacks;
+        bool _in_recovery;
+
+        // RTT, RTO estimates.
+        simtime_picosec _rtt, _rto, _mdev;
+        simtime_picosec _rto_timeout;
+
+        // Connection-level offset of every unacked segment, by subflow offset.
+        std::map<uint64_t, uint64_t> _dsn;
+};
+
+/*
+ * Multipath TCP (RFC 6824) with Linked Increases (LIA, RFC 6356).
+ *
+ * Subflow 0 runs over the connection's own route; addSubflow() adds more,
+ * normally over other cores of the fabric (see
+ * FlowGenerator::setSubflowRoutes). Each subflow takes the next chunk of
+ * connection data whenever its window opens and recovers its own losses.
+ * The subflows' windows are coupled in congestion avoidance: an ack of
+ * b bytes on subflow i grows it by
+ *   min(alpha * b * MSS / cwnd_total, b * MSS / cwnd_i),
+ *   alpha = cwnd_total * max(cwnd_j / rtt_j^2) / (sum(cwnd_j / rtt_j))^2,
+ * so together they take no more than one TCP would on the best path.
+ * Slow start, fast retransmit and timeouts are per subflow.
+ */
+class MptcpSrc : public DataSource
+{
+    friend class MptcpSink;
+    public:
+        MptcpSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+                 simtime_picosec duration = 0);
+
+        void printStatus();
+        void doNextEvent();
+        void receivePacket(Packet &pkt);
+
+        // Add a subflow over another path; call before the flow starts.
+        void addSubflow(route_t &fwd, route_t &rev);
+
+        // Subflows per connection, including the first.
+        static uint32_t _nSubflows;
+
+        // Flow status.
+        enum FlowStatus {
+            IDLE,
+            NORMAL,
+            FINISH
+        } _state;
+
+        uint32_t _nRetransmits;
+        uint32_t _nTimeouts;
+
+    private:
+        void sendPackets(MptcpSubflow &sf);
+        void sendSegment(MptcpSubflow &sf, uint64_t seq, uint64_t dsn);
+        void increaseWindow(MptcpSubflow &sf, uint64_t acked);
+        void retransmitTimeout(MptcpSubflow &sf, simtime_picosec now);
+        void updateRtt(MptcpSubflow &sf, simtime_picosec rtt);
+        double liaAlpha();
+
+        std::vector<MptcpSubflow*> _subflows;
+        std::vector<std::pair<route_t*, route_t*> > _extra_routes;
+};
+
+/*
+ * MPTCP receiver: acks every packet with its subflow's cumulative ack and
+ * the connection's data ack. Reordering across subflows is absorbed by
+ * one connection-level reorder buffer (DataSink::_received).
+ */
+class MptcpSink : public DataSink
+{
+    friend class MptcpSrc;
+    public:
+        MptcpSink();
+        void receivePacket(Packet &pkt);
+
+    private:
+        struct Subflow {
+            PacketFlow *flow;
+            route_t *route;
+            DataAck::seq_t cumulative_ack;
+            ReorderBuffer received;
+        };
+
+        void addSubflow(PacketFlow &flow, route_t &route);
+
+        std::vector<Subflow> _subflows;
+};
+
+#endif /* MPTCP_H */
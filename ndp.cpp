@@ -0,0 +1,337 @@
+/*
+ * NDP
+ */
+#include "ndp.h"
+#include "queue.h"
+#include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+#include <unordered_map>
+
+using namespace std;
+
+NdpSrc::NdpSrc(TrafficLogger *pktlogger,
+               uint64_t flowsize,
+               simtime_picosec duration)
+    : DataSource(pktlogger, flowsize, duration),
+      _state(IDLE),
+      _rtt(0),
+      _rto(timeFromUs(INIT_RTO_US)),
+      _mdev(0),
+      _rto_timeout(0),
+      _min_rtt(ULLONG_MAX),
+      _last_pull(0),
+      _nTrimmed(0),
+      _nTimeouts(0)
+{
+    // Constructor
+}
+
+void
+NdpSrc::printStatus()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // bytes_transferred/total_bytes == time_elapsed/estimated_fct
+    simtime_picosec estimated_fct;
+    if (_last_acked > 0) {
+        estimated_fct = _flowsize * (current_ts - _start_time) / _last_acked;
+    } else {
+        estimated_fct = 0;
+    }
+
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
+         << " fct " << timeAsUs(estimated_fct)
+         << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time)
+         << " trimmed " << _nTrimmed << '\n';
+}
+
+void
+NdpSrc::doNextEvent()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    NdpSink *sink = (NdpSink*)_sink;
+
+    // A new flow: pull at the rate of the last queue before the receiver,
+    // and send the first window unsolicited.
+    if (_state == IDLE) {
+        _state = NORMAL;
+        for (auto hop : *_route_fwd) {
+            Queue *q = dynamic_cast<Queue*>(hop);
+            if (q != NULL) {
+                sink->_pull_rate = q->bitrate();
+            }
+        }
+
+        for (uint32_t i = 0; i < NDP_INIT_WINDOW; i++) {
+            if (!sendNext()) {
+                break;
+            }
+        }
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+        return;
+    }
+
+    // Cleanup the finished flow once nothing refers to it any more.
+    if (_state == FINISH) {
+        if (_flow._nPackets == 0 && sink->_pulls_queued == 0) {
+            delete _sink;
+            delete _route_fwd;
+            delete _route_rev;
+            delete this;
+            return;
+        }
+        EventList::Get().sourceIsPendingRel(*this, timeFromUs(MIN_RTO_US));
+        return;
+    }
+
+    // Retransmission timeout: a header or the pulls it would have earned
+    // were lost. Resend the first unacked segment without waiting for one.
+    if (_rto_timeout != 0 && current_ts >= _rto_timeout) {
+        OUTPUT(RTO) << str() << " at " << timeAsMs(current_ts)
+             << " RTO " << timeAsUs(_rto)
+             << " MDEV " << timeAsUs(_mdev)
+             << " RTT "<< timeAsUs(_rtt)
+             << " SEQ " << _last_acked
+             << " RTO_timeout " << timeAsMs(_rto_timeout) << '\n';
+
+        _nTimeouts++;
+        _rto *= 2;
+        _rto_timeout = current_ts + _rto;
+        _rtx.push_front(_last_acked);
+        sendNext();
+    }
+
+    // The timeout may move later while we wait; we then just wait again.
+    if (_rto_timeout != 0) {
+        EventList::Get().sourceIsPending(*this, _rto_timeout);
+    } else {
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+    }
+}
+
+void
+NdpSrc::receivePacket(Packet &pkt)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    DataAck *p = (DataAck*)(&pkt);
+    DataAck::seq_t ackno = p->ackno();
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+
+    if (_state == FINISH) {
+        p->free();
+        return;
+    }
+
+    if (p->getFlag(Packet::PULL)) {
+        // Send one packet per pull, including any pulls we missed.
+        uint64_t pullno = p->seqno();
+        p->free();
+
+        while (_last_pull < pullno) {
+            _last_pull++;
+            if (!sendNext()) {
+                _last_pull = pullno;
+            }
+        }
+    } else {
+        // Update rtt and rto estimates.
+        simtime_picosec new_rtt = current_ts - p->ts();
+
+        if (new_rtt < _min_rtt) {
+            _min_rtt = new_rtt;
+        }
+
+        if (_rtt > 0) {
+            uint64_t diff = (new_rtt > _rtt) ? (new_rtt - _rtt) : (_rtt - new_rtt);
+            _mdev = 3 * _mdev/4 + diff/4;
+            _rtt = 7 * _rtt/8 + new_rtt/8;
+        } else {
+            _rtt = new_rtt;
+            _mdev = new_rtt/2;
+        }
+
+        _rto = _rtt + 4 * _mdev;
+        if (_rto < timeFromUs(MIN_RTO_US)) {
+            _rto = timeFromUs(MIN_RTO_US);
+        }
+
+        // The payload was trimmed; resend it on a later pull.
+        if (p->getFlag(Packet::NACK)) {
+            _nTrimmed++;
+            _rtx.push_back(p->seqno() - 1);
+        }
+        p->free();
+    }
+
+    if ((_flowsize > 0 && ackno >= _flowsize) ||
+            (_duration > 0 && current_ts > _start_time + _duration)) {
+
+        if (_flowgen != NULL) {
+            _flowgen->finishFlow(id);
+        }
+        _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
+
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
+             << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
+             << " fct " << timeAsUs(current_ts - _start_time)
+             << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+             << " rate " << _flowsize * 8000.0 / (current_ts - _start_time)
+             << " trimmed " << _nTrimmed
+             << " minrtt " << _min_rtt << '\n';
+
+        return;
+    }
+
+    if (ackno > _last_acked) {
+        _last_acked = ackno;
+        _rto_timeout = (ackno >= _highest_sent) ? 0 : current_ts + _rto;
+    }
+}
+
+bool
+NdpSrc::sendNext()
+{
+    // Retransmissions first, skipping any the receiver has since got.
+    while (!_rtx.empty()) {
+        uint64_t seq = _rtx.front();
+        _rtx.pop_front();
+        if (seq >= _last_acked) {
+            sendSegment(seq);
+            return true;
+        }
+    }
+
+    if (_flowsize > 0 && _highest_sent >= _flowsize) {
+        return false;
+    }
+
+    sendSegment(_highest_sent);
+    _highest_sent += MSS_BYTES;
+    return true;
+}
+
+void
+NdpSrc::sendSegment(uint64_t seq)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, seq + 1, MSS_BYTES);
+    p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
+    p->set_ts(current_ts);
+
+    _packets_sent += MSS_BYTES;
+    p->sendOn();
+
+    if (_rto_timeout == 0) {
+        _rto_timeout = current_ts + _rto;
+    }
+}
+
+
+NdpSink::NdpSink()
+    : DataSink(),
+    _pull_rate(10000000000),
+    _pull_no(0),
+    _pulls_queued(0)
+{}
+
+void
+NdpSink::receivePacket(Packet &pkt)
+{
+    DataPacket *p = (DataPacket*)(&pkt);
+    bool trimmed = p->getFlag(Packet::TRIMMED);
+
+    processDataPacket(*p);
+
+    DataAck *ack = DataAck::newpkt(_src->_flow, *_route, p->seqno(), _cumulative_ack);
+    ack->setFlag(Packet::ACK);
+    if (trimmed) {
+        ack->setFlag(Packet::NACK);
+    }
+    ack->conga_info = p->conga_info;
+    ack->set_ts(p->ts());
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+    p->free();
+
+    ack->flow().logTraffic(*ack, *this, TrafficLogger::PKT_CREATESEND);
+    ack->sendOn();
+
+    // Every arrival, header or not, earns the sender another packet.
+    if (_src->_flowsize == 0 || _cumulative_ack < _src->_flowsize) {
+        _pulls_queued++;
+        NdpPuller::forNode(_node_id, _pull_rate).requestPull(*this);
+    }
+}
+
+void
+NdpSink::sendPull()
+{
+    // Nothing left to pull.
+    if (_src->_flowsize > 0 && _cumulative_ack >= _src->_flowsize) {
+        return;
+    }
+
+    DataAck *pull = DataAck::newpkt(_src->_flow, *_route, ++_pull_no, _cumulative_ack);
+    pull->setFlag(Packet::ACK);
+    pull->setFlag(Packet::PULL);
+    pull->conga_info = Packet::CongaInfo();
+    pull->set_ts(EventList::Get().now());
+
+    pull->flow().logTraffic(*pull, *this, TrafficLogger::PKT_CREATESEND);
+    pull->sendOn();
+}
+
+
+NdpPuller&
+NdpPuller::forNode(uint32_t node,
+                   linkspeed_bps rate)
+{
+    static unordered_map<uint32_t, NdpPuller*> pullers;
+
+    auto it = pullers.find(node);
+    if (it == pullers.end()) {
+        it = pullers.emplace(node, new NdpPuller(rate)).first;
+    }
+    return *it->second;
+}
+
+NdpPuller::NdpPuller(linkspeed_bps rate)
+    : PacedSource(),
+    _interval(timeFromSec((MSS_BYTES * 8.0) / rate)),
+    _pace_next(0)
+{}
+
+void
+NdpPuller::requestPull(NdpSink &sink)
+{
+    _pending.push_back(&sink);
+    if (!_pace_pending) {
+        Pacer::Get().schedule(*this, _pace_next);
+    }
+}
+
+void
+NdpPuller::pacedSend()
+{
+    if (_pending.empty()) {
+        return;
+    }
+
+    NdpSink *sink = _pending.front();
+    _pending.pop_front();
+    sink->_pulls_queued--;
+    sink->sendPull();
+
+    Pacer &pacer = Pacer::Get();
+    _pace_next = pacer.nextSendTime(_pace_next, _interval);
+    if (!_pending.empty()) {
+        pacer.schedule(*this, _pace_next);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * NDP header
+ */
+#ifndef NDP_H
+#define NDP_H
+
+#include "eventlist.h"
+#include "datasource.h"
+#include "pacer.h"
+
+#include <deque>
+
+#define NDP_INIT_WINDOW 12  // Packets sent unsolicited at the start, about a BDP.
+
+class NdpSink;
+
+/*
+ * NDP-style receiver-driven transport (Handley et al., SIGCOMM 2017),
+ * meant to run over trimming queues (--queue=trim).
+ *
+ * The sender blasts NDP_INIT_WINDOW packets at line rate and from then on
+ * only sends when pulled: one packet per PULL, a retransmission if any is
+ * owed, else new data. Queues that overflow trim data to a header, and the
+ * receiver answers a header with a NACK, which queues the packet for
+ * retransmission, so losses cost an RTT, not an RTO. The receiver asks
+ * for one packet per packet or header that arrives, and its puller paces
+ * the PULLs of all flows into the host at the host's link rate, so in
+ * steady state data arrives just as fast as the last hop can take it.
+ * Pulls are numbered; a sender that misses some catches up on the next.
+ * An RTO remains for lost headers and control packets.
+ */
+class NdpSrc : public DataSource
+{
+    friend class NdpSink;
+    public:
+        NdpSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+               simtime_picosec duration = 0);
+
+        void printStatus();
+        void doNextEvent();
+        void receivePacket(Packet &pkt);
+
+        // Flow status.
+        enum FlowStatus {
+            IDLE,
+            NORMAL,
+            FINISH
+        } _state;
+
+        // RTT, RTO estimates.
+        simtime_picosec _rtt, _rto, _mdev;
+        simtime_picosec _rto_timeout;
+        simtime_picosec _min_rtt;
+
+        uint64_t _last_pull;     // Highest PULL number served.
+        uint32_t _nTrimmed;      // NACKs for trimmed packets.
+        uint32_t _nTimeouts;
+
+    private:
+        // Send the next packet owed, if any. Returns false if there is none.
+        bool sendNext();
+        void sendSegment(uint64_t seq);
+
+        std::deque<uint64_t> _rtx;  // Segments NACKed, awaiting a pull.
+};
+
+/*
+ * NDP receiver: acks (or, for trimmed packets, NACKs) every arrival and
+ * asks its host's puller for one more packet.
+ */
+class NdpSink : public DataSink
+{
+    friend class NdpSrc;
+    friend class NdpPuller;
+    public:
+        NdpSink();
+        void receivePacket(Packet &pkt);
+
+    private:
+        void sendPull();
+
+        linkspeed_bps _pull_rate;   // Link rate into the receiving host.
+        uint64_t _pull_no;
+        uint32_t _pulls_queued;     // PULLs waiting in the puller.
+};
+
+/*
+ * Paces the PULLs of every flow into one host at MSS_BYTES per link rate,
+ * in the order they were earned. One per host (sink _node_id), made on first
+ * use; clocked by the shared Pacer.
+ */
+class NdpPuller : public PacedSource
+{
+    public:
+        static NdpPuller& forNode(uint32_t node, linkspeed_bps rate);
+
+        void requestPull(NdpSink &sink);
+        void pacedSend();
+
+    private:
+        NdpPuller(linkspeed_bps rate);
+
+        std::deque<NdpSink*> _pending;
+        simtime_picosec _interval;
+        simtime_picosec _pace_next;
+};
+
+#endif /* NDP_H */
@@ -4,6 +4,7 @@
 #include "network.h"
 
 uint32_t Logged::LASTIDNUM = 1;
+Packet::IntRecord *Packet::_intFree = NULL;
 
 void
 Packet::set(PacketFlow &flow,
@@ -18,6 +19,46 @@ Packet::set(PacketFlow &flow,
     _nexthop = 0;
     _flags = 0;
     _priority = 0;
+    assert(_int == NULL);
+}
+
+Packet::IntRecord *
+Packet::allocInt()
+{
+    IntRecord *rec = _intFree;
+    if (rec != NULL) {
+        _intFree = rec->next;
+    } else {
+        rec = new IntRecord;
+    }
+    rec->n = 0;
+    return rec;
+}
+
+void
+Packet::copyInt(const Packet &pkt)
+{
+    if (pkt._int == NULL) {
+        releaseInt();
+        return;
+    }
+    if (_int == NULL) {
+        _int = allocInt();
+    }
+    _int->n = pkt._int->n;
+    for (uint32_t i = 0; i < _int->n; i++) {
+        _int->hops[i] = pkt._int->hops[i];
+    }
+}
+
+void
+Packet::releaseInt()
+{
+    if (_int != NULL) {
+        _int->next = _intFree;
+        _intFree = _int;
+        _int = NULL;
+    }
 }
 
 void
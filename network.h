@@ -18,6 +18,9 @@ typedef std::vector<PacketSink *> route_t;
 typedef std::vector<route_t *> routes_t;
 typedef uint32_t packetid_t;
 
+#define MAX_INT_HOPS 8        // In-band telemetry records a packet can carry.
+#define NODE_ANY UINT32_MAX   // Route generators pick the node at random.
+
 // See datapacket.h to illustrate how Packet is typically used.
 class Packet {
     friend class PacketFlow;
@@ -29,10 +32,24 @@ public:
         ECN_REV = 1,
         PP_FIRST = 2,
         DEADLINE = 3,
-        ACK = 4
+        ACK = 4,
+        CNP = 5,  // DCQCN congestion notification
+        NACK = 6, // Out-of-order data at a go-back-N receiver
+        INT = 7,  // Collect in-band telemetry at every queue
+        TRIMMED = 8, // Payload cut off by a trimming queue
+        PULL = 9  // Receiver-driven transport: send one more packet
+    };
+
+    // In-band telemetry: one record per queue, taken as the packet departs.
+    struct IntHop {
+        uint32_t queueId;
+        linkspeed_bps bitrate;
+        mem_b qlen;        // Queue occupancy as the packet departs.
+        uint64_t txBytes;  // Bytes the queue has sent so far.
+        simtime_picosec ts;
     };
 
-    Packet() {
+    Packet() : _int(NULL) {
     };
 
     virtual ~Packet() {
@@ -44,6 +61,11 @@ public:
     // Send the packet to next hop.
     virtual void sendOn();
 
+    // Where the packet is on its route: sendOn() goes to route()[nextHop()].
+    inline route_t &route() const { return *_route; }
+    inline uint32_t nextHop() const { return _nexthop; }
+    inline void setNextHop(uint32_t hop) { _nexthop = hop; }
+
     // Return protected members.
     mem_b size() const { return _size; }
     PacketFlow &flow() const { return *_flow; }
@@ -53,11 +75,34 @@ public:
     inline void unsetFlag(PacketFlag flag) { _flags = _flags & ~(1 << flag); }
     inline uint8_t getFlag(PacketFlag flag) { return (_flags & (1 << flag)) ? 1 : 0; }
 
+    // Cut the payload off on overflow, leaving only the header.
+    inline void trim(mem_b headerSize) {
+        _size = headerSize;
+        setFlag(TRIMMED);
+    }
+
     inline void setPriority(uint32_t p) { _priority = p; }
     inline uint32_t getPriority() { return _priority; }
 
     uint32_t getFlags() const { return _flags; }
 
+    inline void pushIntHop(const IntHop &hop) {
+        if (_int == NULL) {
+            _int = allocInt();
+        }
+        if (_int->n < MAX_INT_HOPS) {
+            _int->hops[_int->n++] = hop;
+        }
+    }
+    inline uint32_t nIntHops() const { return _int == NULL ? 0 : _int->n; }
+    inline const IntHop &intHop(uint32_t i) const { return _int->hops[i]; }
+
+    // Echo another packet's telemetry (receiver to sender).
+    void copyInt(const Packet &pkt);
+
+    // Hand the telemetry back to the pool; free() does so.
+    void releaseInt();
+
     struct CongaInfo {
         uint32_t src_leaf_id;
         uint32_t core_id;
@@ -97,6 +142,18 @@ protected:
 
     uint32_t _flags;
     uint32_t _priority;
+
+    // Telemetry lives out of line, so only packets that collect it pay
+    // for it; records are pooled like the packets.
+    struct IntRecord {
+        uint32_t n;
+        IntHop hops[MAX_INT_HOPS];
+        IntRecord *next;    // In the free list.
+    };
+    static IntRecord *allocInt();
+
+    IntRecord *_int;
+    static IntRecord *_intFree;
 };
 
 class PacketFlow : public Logged {
@@ -0,0 +1,130 @@
+/*
+ * Simulator output
+ */
+#include "output.h"
+
+using namespace std;
+
+Output *Output::instance = NULL;
+uint32_t Output::_mask = (1u << Output::N_CATEGORIES) - 1;
+
+static const char *categoryNames[Output::N_CATEGORIES] = {
+    "start", "finish", "live", "queue", "summary",
+    "rto", "route", "drop", "warn"
+};
+
+static const uint32_t categoryLevels[Output::N_CATEGORIES] = {
+    Output::LEVEL_INFO, Output::LEVEL_INFO, Output::LEVEL_INFO, Output::LEVEL_INFO,
+    Output::LEVEL_SUMMARY, Output::LEVEL_DEBUG, Output::LEVEL_DEBUG, Output::LEVEL_DEBUG,
+    Output::LEVEL_DEBUG
+};
+
+static void
+flushOutput()
+{
+    Output::Get().flush();
+}
+
+Output&
+Output::Get()
+{
+    if (instance == NULL) {
+        instance = new Output;
+        atexit(flushOutput);
+    }
+    return *instance;
+}
+
+Output::Output()
+    : _buffer(stdout, OUTPUT_BUFFER_SIZE),
+    _stream(&_buffer)
+{
+    // Print everything unless told otherwise.
+    setLevel(LEVEL_DEBUG);
+}
+
+void
+Output::setLevel(uint32_t level)
+{
+    _mask = 0;
+    for (uint32_t i = 0; i < N_CATEGORIES; i++) {
+        if (categoryLevels[i] <= level) {
+            _mask |= (1u << i);
+        }
+    }
+}
+
+void
+Output::setCategories(const string &list)
+{
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == string::npos) {
+            end = list.size();
+        }
+
+        string name = list.substr(pos, end - pos);
+        bool enable = true;
+        if (!name.empty() && name[0] == '-') {
+            enable = false;
+            name = name.substr(1);
+        }
+
+        uint32_t i;
+        for (i = 0; i < N_CATEGORIES; i++) {
+            if (name == categoryNames[i]) {
+                break;
+            }
+        }
+
+        if (i == N_CATEGORIES) {
+            if (!name.empty()) {
+                cerr << "Unknown output category: " << name << endl;
+            }
+        } else if (enable) {
+            _mask |= (1u << i);
+        } else {
+            _mask &= ~(1u << i);
+        }
+
+        pos = end + 1;
+    }
+}
+
+void
+Output::flush()
+{
+    _stream.flush();
+    fflush(stdout);
+}
+
+
+Output::Buffer::Buffer(FILE *fp, size_t size)
+    : _fp(fp),
+    _buf(size)
+{
+    setp(_buf.data(), _buf.data() + _buf.size());
+}
+
+int
+Output::Buffer::overflow(int c)
+{
+    sync();
+    if (c != traits_type::eof()) {
+        *pptr() = (char)c;
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int
+Output::Buffer::sync()
+{
+    size_t n = pptr() - pbase();
+    if (n > 0) {
+        fwrite(pbase(), 1, n, _fp);
+        setp(_buf.data(), _buf.data() + _buf.size());
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Simulator output header
+ */
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include "htsim.h"
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+/*
+ * All text the simulator prints while running goes through Output. Lines
+ * are tagged with a category; each category belongs to a verbosity level
+ * and can also be switched on or off individually at runtime. Enabled text
+ * is collected in a large buffer and written out in big chunks, so printing
+ * never flushes on the hot path. A disabled category costs one bit test:
+ *
+ *     OUTPUT(FLOW_FINISH) << "Flow " << str() << ... << '\n';
+ *
+ * Use '\n' rather than std::endl, which would force a write per line.
+ */
+
+#define OUTPUT(cat) \
+    if (!Output::enabled(Output::cat)) {} else Output::Get().stream()
+
+#define OUTPUT_BUFFER_SIZE (4 << 20)
+
+class Output
+{
+    public:
+        enum Category {
+            FLOW_START  = 0, // flow start records
+            FLOW_FINISH = 1, // flow finish records
+            LIVE_FLOW   = 2, // unfinished flows dumped at the end
+            QUEUE_STATS = 3, // periodic per-queue occupancy
+            SUMMARY     = 4, // end of run summaries
+            RTO         = 5, // retransmission timeouts
+            ROUTE       = 6, // load balancer path choices
+            DROP        = 7, // switch drops
+            WARNING     = 8, // unexpected protocol events
+            N_CATEGORIES
+        };
+
+        enum Level {
+            LEVEL_QUIET   = 0, // nothing at all
+            LEVEL_SUMMARY = 1, // end of run summaries only
+            LEVEL_INFO    = 2, // per-flow records
+            LEVEL_DEBUG   = 3  // everything (default)
+        };
+
+        // Returns the output instance.
+        static Output& Get();
+
+        static inline bool enabled(Category cat) { return _mask & (1u << cat); }
+
+        // Enable every category up to (and including) the given level.
+        void setLevel(uint32_t level);
+
+        // Enable/disable categories by name, e.g. "finish,summary,-route".
+        void setCategories(const std::string &list);
+
+        std::ostream& stream() { return _stream; }
+
+        // Write out everything buffered so far.
+        void flush();
+
+    private:
+        Output();
+        ~Output(){};
+        Output(const Output&);
+        Output& operator=(const Output&);
+
+        static Output *instance;
+        static uint32_t _mask;
+
+        class Buffer : public std::streambuf
+        {
+            public:
+                Buffer(FILE *fp, size_t size);
+            protected:
+                int overflow(int c);
+                int sync();
+            private:
+                FILE *_fp;
+                std::vector<char> _buf;
+        };
+
+        Buffer _buffer;
+        std::ostream _stream;
+};
+
+#endif /* OUTPUT_H */
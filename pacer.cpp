@@ -0,0 +1,182 @@
+/*
+ * Pacer
+ */
+#include "pacer.h"
+
+using namespace std;
+
+Pacer *Pacer::instance = NULL;
+
+Pacer&
+Pacer::Get()
+{
+    if (instance == NULL) {
+        instance = new Pacer(timeFromNs(100), 4096);
+    }
+    return *instance;
+}
+
+Pacer::Pacer(simtime_picosec tick,
+             uint32_t nSlots)
+    : EventSource("pacer"),
+    _nDispatched(0),
+    _nBatches(0),
+    _tick(tick),
+    _nSlots(nSlots),
+    _cursor(0),
+    _nQueued(0),
+    _slots(nSlots),
+    _busy((nSlots + 63) / 64, 0),
+    _armed(ULLONG_MAX)
+{
+    assert(nSlots >= 64 && (nSlots & (nSlots - 1)) == 0);
+}
+
+void
+Pacer::schedule(PacedSource &src,
+                simtime_picosec when)
+{
+    assert(!src._pace_pending);
+
+    simtime_picosec now = EventList::Get().now();
+    if (when < now) {
+        when = now;
+    }
+
+    // An idle wheel may lag far behind; catch it up so we don't overflow.
+    if (_nQueued == 0) {
+        advance(now / _tick);
+    }
+
+    uint64_t tick = (when + _tick - 1) / _tick;
+    src._pace_pending = true;
+    _nQueued++;
+    insert(tick, &src);
+    arm(tick);
+}
+
+simtime_picosec
+Pacer::nextSendTime(simtime_picosec prev,
+                    simtime_picosec interval)
+{
+    simtime_picosec now = EventList::Get().now();
+
+    // Served up to a tick late is still on schedule.
+    if (prev + _tick < now) {
+        prev = now;
+    }
+    return prev + interval;
+}
+
+void
+Pacer::insert(uint64_t tick,
+              PacedSource *src)
+{
+    if (tick < _cursor) {
+        tick = _cursor;
+    }
+
+    if (tick - _cursor >= _nSlots) {
+        _overflow.insert(make_pair(tick, src));
+        return;
+    }
+
+    uint32_t i = tick & (_nSlots - 1);
+    _slots[i].push_back(src);
+    _busy[i >> 6] |= (1ULL << (i & 63));
+}
+
+uint64_t
+Pacer::nextBusyTick() const
+{
+    uint32_t first = _cursor & (_nSlots - 1);
+
+    // Scan the busy bitmap a word at a time, starting at the cursor. The
+    // cursor's own word comes round again last, for the slots before it.
+    uint32_t off = 0;
+    while (off < _nSlots) {
+        uint32_t i = (first + off) & (_nSlots - 1);
+        uint64_t word = _busy[i >> 6] >> (i & 63);
+        if (word != 0) {
+            uint32_t d = __builtin_ctzll(word);
+            if (off + d < _nSlots) {
+                return _cursor + off + d;
+            }
+            break;
+        }
+        off += 64 - (i & 63);
+    }
+
+    if (!_overflow.empty()) {
+        return _overflow.begin()->first;
+    }
+    return ULLONG_MAX;
+}
+
+void
+Pacer::advance(uint64_t tick)
+{
+    if (tick <= _cursor) {
+        return;
+    }
+    _cursor = tick;
+
+    while (!_overflow.empty() && _overflow.begin()->first - _cursor < _nSlots) {
+        auto it = _overflow.begin();
+        insert(it->first, it->second);
+        _overflow.erase(it);
+    }
+}
+
+void
+Pacer::runSlot(uint64_t tick)
+{
+    uint32_t i = tick & (_nSlots - 1);
+    _nBatches++;
+
+    // Senders may queue themselves again for this same tick.
+    while (_busy[i >> 6] & (1ULL << (i & 63))) {
+        _batch.swap(_slots[i]);
+        _busy[i >> 6] &= ~(1ULL << (i & 63));
+
+        for (PacedSource *src : _batch) {
+            src->_pace_pending = false;
+            _nQueued--;
+            _nDispatched++;
+            src->pacedSend();
+        }
+        _batch.clear();
+    }
+}
+
+void
+Pacer::arm(uint64_t tick)
+{
+    simtime_picosec when = tick * _tick;
+    if (when < _armed) {
+        _armed = when;
+        EventList::Get().sourceIsPending(*this, when);
+    }
+}
+
+void
+Pacer::doNextEvent()
+{
+    simtime_picosec now = EventList::Get().now();
+    uint64_t target = now / _tick;
+
+    if (now >= _armed) {
+        _armed = ULLONG_MAX;
+    }
+
+    uint64_t tick;
+    while ((tick = nextBusyTick()) <= target) {
+        advance(tick);
+        runSlot(tick);
+    }
+    advance(target);
+
+    if (tick != ULLONG_MAX) {
+        arm(tick);
+    }
+}
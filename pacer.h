@@ -0,0 +1,99 @@
+/*
+ * Pacer header
+ */
+#ifndef PACER_H
+#define PACER_H
+
+#include "eventlist.h"
+
+#include <map>
+#include <vector>
+
+/*
+ * A sender whose transmissions are clocked by the Pacer rather than by
+ * events of its own. pacedSend() runs at (or just after) the time it asked
+ * for; it may send, reschedule itself, or even delete itself.
+ */
+class PacedSource
+{
+    public:
+        PacedSource() : _pace_pending(false) {}
+        virtual ~PacedSource() {}
+
+        virtual void pacedSend() = 0;
+
+        // Set while queued in the pacer; the owner must not be deleted then.
+        bool _pace_pending;
+};
+
+/*
+ * One EventSource that clocks every paced sender in the simulation.
+ *
+ * Send times are rounded up to a tick and kept in a timer wheel of one
+ * slot per tick, with a bitmap of busy slots; times past the end of the
+ * wheel wait in an overflow map until the wheel turns far enough. The
+ * pacer holds a single event on the eventlist, for the earliest busy tick,
+ * and serves all senders due in that tick in one batch. With N flows paced
+ * at similar rates this replaces N per-packet events by one per tick.
+ *
+ * Rounding delays a send by less than one tick. Senders that chain send
+ * times off the ideal schedule, not the time they were served (see
+ * nextSendTime), lose no rate to it.
+ */
+class Pacer : public EventSource
+{
+    public:
+        // Returns the pacer instance.
+        static Pacer& Get();
+
+        // Call pacedSend() on src at time when (clamped to now).
+        void schedule(PacedSource &src, simtime_picosec when);
+
+        // Ideal time of the next send, interval after the previous ideal
+        // time prev. Restarts from now if the sender has been idle.
+        simtime_picosec nextSendTime(simtime_picosec prev, simtime_picosec interval);
+
+        void doNextEvent();
+
+        simtime_picosec tick() const { return _tick; }
+
+        uint64_t _nDispatched; // pacedSend() calls.
+        uint64_t _nBatches;    // Busy ticks served.
+
+    private:
+        Pacer(simtime_picosec tick, uint32_t nSlots);
+        ~Pacer(){};
+        Pacer(const Pacer&); // Copy constructor too.
+        Pacer& operator=(const Pacer&); // Assignment operator too.
+
+        static Pacer *instance;
+
+        // Returns the first tick at or after _cursor with senders queued,
+        // or ULLONG_MAX if there are none.
+        uint64_t nextBusyTick() const;
+
+        // Move the wheel forward to tick and pull in overflow that now fits.
+        void advance(uint64_t tick);
+
+        void insert(uint64_t tick, PacedSource *src);
+        void runSlot(uint64_t tick);
+
+        // Make sure the eventlist will wake us for tick.
+        void arm(uint64_t tick);
+
+        simtime_picosec _tick;
+        uint32_t _nSlots;           // Power of two, at least 64.
+        uint64_t _cursor;           // Tick held by the wheel's first slot.
+        uint64_t _nQueued;          // Senders in the wheel and overflow.
+
+        std::vector<std::vector<PacedSource*> > _slots;
+        std::vector<uint64_t> _busy;
+        std::vector<PacedSource*> _batch;
+        std::multimap<uint64_t,PacedSource*> _overflow;
+
+        // Time of our earliest event on the eventlist (ULLONG_MAX: none).
+        // The eventlist can't cancel events, so later ones may fire stale.
+        simtime_picosec _armed;
+};
+
+#endif /* PACER_H */
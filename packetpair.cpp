@@ -1,5 +1,7 @@
 #include "packetpair.h"
 #include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
 
 #define TRACE_FLOW 0 && "ppSrc"
 
@@ -46,12 +48,12 @@ PacketPairSrc::printStatus()
         estimated_fct = 0;
     }
 
-    cout << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
          << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
          << " fct " << timeAsUs(estimated_fct)
          << " bdp " << _bdp_estimate
          << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
-         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time) << endl;
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time) << '\n';
 }
 
 void
@@ -92,13 +94,13 @@ PacketPairSrc::doNextEvent()
     // Retransmission timeout.
     else if (_rto_timeout != 0 && current_ts >= _rto_timeout) {
 
-        cout << str() << " TMOUT " << timeAsMs(current_ts)
+        OUTPUT(RTO) << str() << " TMOUT " << timeAsMs(current_ts)
              << " RTO " << timeAsUs(_rto)
              << " MDEV " << timeAsUs(_mdev)
              << " RTT "<< timeAsUs(_rtt)
              << " SEQ " << _last_acked
              << " RTO_timeout " << timeAsMs(_rto_timeout)
-             << " STATE " << _state << endl;
+             << " STATE " << _state << '\n';
 
         _recover_seq = _highest_sent;
         _highest_sent = _last_acked + MSS_BYTES;
@@ -146,8 +148,9 @@ PacketPairSrc::receivePacket(Packet& pkt)
             _flowgen->finishFlow(id);
         }
         _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
 
-        cout << setprecision(6) << "Flow " << str() << " size " << _flowsize
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << " size " << _flowsize
              << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
              << " fct " << timeAsUs(current_ts - _start_time)
              << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
@@ -155,14 +158,14 @@ PacketPairSrc::receivePacket(Packet& pkt)
              << " rate " << speedAsGbps(_rate_estimate)
              << " bdp " << _bdp_estimate
              << " alpha " << _alpha
-             << " minrtt " << _min_rtt << endl;
+             << " minrtt " << _min_rtt << '\n';
 
         return;
     }
 
     // Delayed / reordered ack. Shouldn't happen for simple queues.
     if (seqno < _last_acked) {
-        cout << str() << " ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << endl;
+        OUTPUT(WARNING) << str() << " ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << '\n';
         return;
     }
 
@@ -469,8 +472,8 @@ PacketPairSink::receivePacket(Packet& pkt)
         }
 
         if (_pktpairdiff > 0 && _pktpairdiff < 800000) {
-            cout << str() << " WTF! " << seqno << " " << EventList::Get().now()
-                 << " " << _first_pair_ts << " " << _pktpairdiff << " " << p->size() << endl;
+            OUTPUT(WARNING) << str() << " WTF! " << seqno << " " << EventList::Get().now()
+                 << " " << _first_pair_ts << " " << _pktpairdiff << " " << p->size() << '\n';
         }
 
         _first_pair_ts = 0;
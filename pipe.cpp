@@ -10,20 +10,40 @@ void
 Pipe::receivePacket(Packet &pkt)
 {
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
+    enqueue(pkt, EventList::Get().now() + _delay);
+}
+
+void
+Pipe::receivePacket(Packet &pkt,
+                    simtime_picosec exit)
+{
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
+    enqueue(pkt, exit);
+}
+
+void
+Pipe::enqueue(Packet &pkt,
+              simtime_picosec exit)
+{
+    // Only fast-forwarded packets can be overtaken.
+    auto it = _inflight.begin();
+    while (it != _inflight.end() && it->first > exit) {
+        it++;
+    }
 
-    if (_inflight.empty()) {
-        // no packets currently inflight.
-        // need to notify the eventlist we've an event pending
-        EventList::Get().sourceIsPendingRel(*this, _delay);
+    if (it == _inflight.end()) {
+        // it's the next out, notify the eventlist we've an event pending
+        EventList::Get().sourceIsPending(*this, exit);
     }
 
-    _inflight.push_front(make_pair(EventList::Get().now() + _delay, &pkt));
+    _inflight.insert(it, make_pair(exit, &pkt));
 }
 
 void
 Pipe::doNextEvent()
 {
-    if (_inflight.size() == 0) {
+    // Overtaking leaves an event behind for the packet that was next out.
+    if (_inflight.size() == 0 || _inflight.back().first > EventList::Get().now()) {
         return;
     }
 
@@ -18,11 +18,18 @@ class Pipe : public EventSource, public PacketSink
         void receivePacket(Packet &pkt); // inherited from PacketSink
         void doNextEvent(); // inherited from EventSource
         simtime_picosec delay() { return _delay; }
+        bool idle() const { return _inflight.empty(); }
+
+        // A packet fast-forwarded here (Queue::fastForward), to come out at
+        // exit. Packets that enter later may come out before it.
+        void receivePacket(Packet &pkt, simtime_picosec exit);
 
     private:
+        void enqueue(Packet &pkt, simtime_picosec exit);
+
         simtime_picosec _delay;
         typedef std::pair<simtime_picosec,Packet *> pktrecord_t;
-        std::deque<pktrecord_t> _inflight; // the packets in flight (or being serialized)
+        std::deque<pktrecord_t> _inflight; // the packets in flight (or being serialized), latest exit first
 };
 
 #endif /* PIPE_H */
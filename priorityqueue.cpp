@@ -1,11 +1,14 @@
 #include "priorityqueue.h"
 
+#include <algorithm>
+
 #define TRACE_PKT 0 && 4304
 
 using namespace std;
 
 PriorityQueue::PriorityQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger)
-    : Queue(bitrate, maxsize, logger)
+    : Queue(bitrate, maxsize, logger),
+      _currentPkt(NULL)
 {
 }
 
@@ -13,12 +16,19 @@ void
 PriorityQueue::beginService()
 {
     if (!_packets.empty()) {
-        // Remove packet from the queue for transmit.
-        _currentPkt = *_packets.begin();
-        _packets.erase(_packets.begin());
+        // Transmit the earliest packet of the highest-priority flow rather
+        // than the highest-priority packet, which may have been sent after
+        // others of its flow (as pFabric does), so flows are not reordered.
+        auto it = _flowPackets.find(&(*_packets.begin())->flow());
+        _currentPkt = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) {
+            _flowPackets.erase(it);
+        }
+        erasePacket(_currentPkt);
 
         // Schedule it's completion time.
-        EventList::Get().sourceIsPendingRel(*this, drainTime(_currentPkt));
+        EventList::Get().sourceIsPendingRel(*this, serviceTime(_currentPkt));
 
         if (TRACE_PKT == _currentPkt->flow().id) {
             cout << str() << " Pkt depart sched " << EventList::Get().now() << " "
@@ -43,6 +53,7 @@ PriorityQueue::completeService()
     }
 
     applyEcnMark(*_currentPkt);
+    appendInt(*_currentPkt);
     _currentPkt->sendOn();
 
     // Clear packet being transmitted.
@@ -63,6 +74,7 @@ PriorityQueue::receivePacket(Packet& pkt)
     }
 
     _packets.insert(&pkt);
+    _flowPackets[&pkt.flow()].push_back(&pkt);
     _queuesize += pkt.size();
 
     if (_logger) {
@@ -75,6 +87,12 @@ PriorityQueue::receivePacket(Packet& pkt)
         _packets.erase(prev(_packets.end()));
         _queuesize -= p->size();
 
+        auto it = _flowPackets.find(&p->flow());
+        it->second.erase(prev(find(it->second.rbegin(), it->second.rend(), p).base()));
+        if (it->second.empty()) {
+            _flowPackets.erase(it);
+        }
+
         if (_logger) {
             _logger->logQueue(*this, QueueLogger::PKT_DROP, *p);
         }
@@ -88,7 +106,19 @@ PriorityQueue::receivePacket(Packet& pkt)
 }
 
 void
-PriorityQueue::printStats()
+PriorityQueue::erasePacket(Packet *pkt)
+{
+    auto range = _packets.equal_range(pkt);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (*it == pkt) {
+            _packets.erase(it);
+            return;
+        }
+    }
+}
+
+void
+PriorityQueue::printStats(ostream &out)
 {
     unordered_map<uint32_t, uint32_t> counts;
 
@@ -100,9 +130,9 @@ PriorityQueue::printStats()
         counts[fid] = counts[fid] + 1;
     }
 
-    cout << str() << " stats ";
+    out << str() << " stats ";
     for (auto it = counts.begin(); it != counts.end(); it++) {
-        cout << " " << it->second;
+        out << " " << it->second;
     }
-    cout << endl;
+    out << '\n';
 }
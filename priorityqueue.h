@@ -7,7 +7,9 @@
 
 #include "queue.h"
 
+#include <deque>
 #include <set>
+#include <unordered_map>
 
 class ComparePacketPriority
 {
@@ -27,16 +29,24 @@ class PriorityQueue : public Queue
 public:
     PriorityQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger);
     void receivePacket(Packet &pkt);
-    void printStats();
+    bool fastForwardable() const override { return false; }
+    void printStats(std::ostream &out);
 
 protected:
     void beginService();
     void completeService();
 
 private:
-    // Multi-set of all packets, to transmit from head or drop from tail.
+    // Take pkt out of the priority order.
+    void erasePacket(Packet *pkt);
+
+    // Multi-set of all packets, to pick the flow to transmit from head or
+    // drop from tail.
     std::multiset<Packet*, ComparePacketPriority> _packets;
 
+    // Each flow's queued packets in arrival order.
+    std::unordered_map<PacketFlow*, std::deque<Packet*>> _flowPackets;
+
     // Current packet being serviced.
     Packet *_currentPkt;
 };
@@ -2,17 +2,33 @@
  * FIFO queue
  */
 #include "queue.h"
+#include "pipe.h"
 #include "prof.h"
 
 using namespace std;
 
+mem_b Queue::_ecn_threshold = 0;
+bool Queue::_fast_forward = false;
+simtime_picosec Queue::_ff_horizon = timeFromUs(FF_HORIZON_US);
+
 Queue::Queue(linkspeed_bps bitrate,
              mem_b maxsize,
              QueueLogger* logger)
              : EventSource("queue"),
              _maxsize(maxsize),
              _queuesize(0),
+             _txBytes(0),
+             _nTrimmed(0),
+             _headersize(0),
+             _trim(false),
+             _servingHeader(false),
              _bitrate(bitrate),
+             _fluid_rate(0),
+             _fluid_backlog(0),
+             _fluid_wait(0),
+             _fluid_bytes(0),
+             _fluid_since(0),
+             _last_departure(ULLONG_MAX),
              _logger(logger)
 {
     _ps_per_byte = (simtime_picosec)(8 * 1000000000000UL / _bitrate);
@@ -21,17 +37,162 @@ Queue::Queue(linkspeed_bps bitrate,
 void
 Queue::beginService()
 {
-    assert(!_enqueued.empty());
-    EventList::Get().sourceIsPendingRel(*this, drainTime(_enqueued.back()));
+    assert(!idle());
+    _servingHeader = !_headers.empty();
+    Packet *pkt = _servingHeader ? _headers.back() : _enqueued.back();
+    simtime_picosec service = serviceTime(pkt);
+
+    if (_reserved.empty() && !_fast_forward) {
+        EventList::Get().sourceIsPendingRel(*this, service);
+        return;
+    }
+
+    simtime_picosec now = EventList::Get().now();
+    dropReservations(now);
+
+    simtime_picosec start = serviceStart(now, service);
+    if (_fast_forward && _enqueued.size() == 1 && _headers.empty() && fastForwardable()
+            && fastForward(*pkt, start)) {
+        return;
+    }
+    EventList::Get().sourceIsPending(*this, start + service);
+}
+
+bool
+Queue::fastForward(Packet &pkt,
+                   simtime_picosec start)
+{
+    route_t &route = pkt.route();
+    uint32_t hop = pkt.nextHop();
+    Pipe *pipe = hop < route.size() ? dynamic_cast<Pipe*>(route[hop]) : NULL;
+    if (pipe == NULL || pkt.getFlag(Packet::INT)) {
+        return false;
+    }
+
+    _enqueued.pop_back();
+    _queuesize -= pkt.size();
+    simtime_picosec now = EventList::Get().now();
+    simtime_picosec t = passThrough(pkt, now, start, serviceTime(&pkt)) + pipe->delay();
+
+    // Every hop here is a queue then a pipe; go on while the queue has no
+    // packets of its own, only fast-forwarded ones to wait behind. Packets
+    // still in the pipe would get there first, so it must be empty too: a
+    // flow's packets are never reordered, even if other links' may beat it
+    // to the queue.
+    for (hop++; hop + 1 < route.size(); hop += 2) {
+        Queue *q = dynamic_cast<Queue*>(route[hop]);
+        Pipe *next = dynamic_cast<Pipe*>(route[hop + 1]);
+        if (t - now >= _ff_horizon || q == NULL || next == NULL || !pipe->idle()
+                || !q->fastForwardable() || !q->idle()) {
+            break;
+        }
+
+        pkt.flow().logTraffic(pkt, *q, TrafficLogger::PKT_ARRIVE);
+        if (q->_logger) {
+            q->_logger->logQueue(*q, QueueLogger::PKT_ENQUEUE, pkt);
+        }
+        q->dropReservations(now);
+        q->onArrival(pkt, q->occupancy(t) + pkt.size());
+
+        // It starts a busy period there, so waits out any fluid backlog.
+        simtime_picosec service = q->drainTime(&pkt) + (q->_fluid_backlog > 0 ? q->_fluid_wait : 0);
+        t = q->passThrough(pkt, t, q->serviceStart(t, service), service) + next->delay();
+        pipe = next;
+    }
+
+    pkt.setNextHop(hop);
+    pipe->receivePacket(pkt, t);
+    return true;
+}
+
+simtime_picosec
+Queue::passThrough(Packet &pkt,
+                   simtime_picosec arrival,
+                   simtime_picosec start,
+                   simtime_picosec service)
+{
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_DEPART);
+    if (_logger) {
+        _logger->logQueue(*this, QueueLogger::PKT_SERVICE, pkt);
+    }
+
+    // Marked on what is ahead of it when it arrives.
+    if (ENABLE_ECN && _queuesize + _fluid_backlog + reservedBytes(arrival) > dctcpThreshold()) {
+        pkt.setFlag(Packet::ECN_FWD);
+    }
+    _txBytes += pkt.size();
+
+    Reservation r;
+    r.arrival = arrival;
+    r.from = start;
+    r.until = start + service;
+    r.bytes = pkt.size();
+
+    auto it = _reserved.end();
+    while (it != _reserved.begin() && (it - 1)->from > r.from) {
+        it--;
+    }
+    _reserved.insert(it, r);
+    return r.until;
+}
+
+void
+Queue::dropReservations(simtime_picosec now)
+{
+    while (!_reserved.empty() && _reserved.front().until <= now) {
+        _reserved.pop_front();
+    }
+}
+
+simtime_picosec
+Queue::serviceStart(simtime_picosec arrival,
+                    simtime_picosec service)
+{
+    simtime_picosec start = arrival;
+    for (const Reservation &r : _reserved) {
+        if (r.arrival <= arrival) {
+            start = max(start, r.until);
+        }
+    }
+
+    for (const Reservation &r : _reserved) {
+        if (r.until <= start) {
+            continue;
+        }
+        if (start + service <= r.from) {
+            break;
+        }
+        start = r.until;
+    }
+    return start;
+}
+
+mem_b
+Queue::reservedBytes(simtime_picosec now) const
+{
+    mem_b bytes = 0;
+    for (const Reservation &r : _reserved) {
+        if (r.arrival <= now && now < r.until) {
+            bytes += r.bytes;
+        }
+    }
+    return bytes;
 }
 
 void
 Queue::completeService()
 {
-    assert(!_enqueued.empty());
+    assert(!idle());
 
-    Packet *pkt = _enqueued.back();
-    _enqueued.pop_back();
+    Packet *pkt;
+    if (_servingHeader) {
+        pkt = _headers.back();
+        _headers.pop_back();
+        _headersize -= pkt->size();
+    } else {
+        pkt = _enqueued.back();
+        _enqueued.pop_back();
+    }
     _queuesize -= pkt->size();
 
     pkt->flow().logTraffic(*pkt, *this, TrafficLogger::PKT_DEPART);
@@ -41,9 +202,10 @@ Queue::completeService()
     }
 
     applyEcnMark(*pkt);
+    appendInt(*pkt);
     pkt->sendOn();
 
-    if (!_enqueued.empty()) {
+    if (!idle()) {
         beginService();
     }
 }
@@ -57,7 +219,7 @@ Queue::doNextEvent()
 void
 Queue::receivePacket(Packet &pkt)
 {
-    if (_queuesize + pkt.size() > _maxsize) {
+    if (overflow(pkt)) {
         if (_logger) {
             _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
         }
@@ -68,30 +230,104 @@ Queue::receivePacket(Packet &pkt)
 
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
 
-    bool queueWasEmpty = _enqueued.empty();
-    _enqueued.push_front(&pkt);
-    _queuesize += pkt.size();
+    bool queueWasEmpty = idle();
+    push(pkt);
 
     if (_logger) {
         _logger->logQueue(*this, QueueLogger::PKT_ENQUEUE, pkt);
     }
 
     if (queueWasEmpty) {
-        assert(_enqueued.size() == 1);
         beginService();
     }
 }
 
+bool
+Queue::overflow(Packet &pkt)
+{
+    if (isHeader(pkt)) {
+        return _headersize + pkt.size() > headerBudget();
+    }
+
+    mem_b queued = _queuesize - _headersize + _fluid_backlog;
+    if (!_reserved.empty()) {
+        queued += reservedBytes(EventList::Get().now());
+    }
+
+    if (queued + pkt.size() <= _maxsize - headerBudget()) {
+        return false;
+    }
+    if (!_trim) {
+        return true;
+    }
+
+    pkt.trim(ACK_SIZE);
+    _nTrimmed++;
+    return _headersize + pkt.size() > headerBudget();
+}
+
+void
+Queue::push(Packet &pkt)
+{
+    if (isHeader(pkt)) {
+        _headers.push_front(&pkt);
+        _headersize += pkt.size();
+    } else {
+        _enqueued.push_front(&pkt);
+    }
+    _queuesize += pkt.size();
+}
+
 void
 Queue::applyEcnMark(Packet &pkt)
 {
-    if (ENABLE_ECN && _queuesize > dctcpThreshold()) {
+    mem_b queued = _queuesize + _fluid_backlog;
+    if (!_reserved.empty()) {
+        queued += reservedBytes(EventList::Get().now());
+    }
+
+    if (ENABLE_ECN && queued > dctcpThreshold()) {
         pkt.setFlag(Packet::ECN_FWD);
     }
 }
 
 void
-Queue::printStats()
+Queue::appendInt(Packet &pkt)
+{
+    simtime_picosec now = EventList::Get().now();
+    _txBytes += pkt.size();
+    _last_departure = now;
+
+    if (pkt.getFlag(Packet::INT)) {
+        Packet::IntHop hop;
+        hop.queueId = id;
+        hop.bitrate = _bitrate;
+        hop.qlen = _queuesize + _fluid_backlog;
+        hop.txBytes = _txBytes;
+        hop.ts = now;
+        if (_fluid_rate > 0 || _fluid_bytes > 0) {
+            hop.txBytes += llround(_fluid_bytes + _fluid_rate * timeAsSec(now - _fluid_since) / 8);
+        }
+        pkt.pushIntHop(hop);
+    }
+}
+
+void
+Queue::setFluidLoad(double rate,
+                    mem_b backlog)
+{
+    simtime_picosec now = EventList::Get().now();
+    _fluid_bytes += _fluid_rate * timeAsSec(now - _fluid_since) / 8;
+    _fluid_since = now;
+
+    _fluid_rate = rate;
+    _fluid_backlog = backlog;
+    _fluid_wait = (simtime_picosec)backlog * (8 * 1000000000000UL / _bitrate);
+    _ps_per_byte = (simtime_picosec)(8 * 1000000000000UL / (linkspeed_bps)(_bitrate - rate));
+}
+
+void
+Queue::printStats(ostream &out)
 {
     unordered_map<uint32_t, uint32_t> counts;
 
@@ -104,13 +340,13 @@ Queue::printStats()
     }
 
 #if MING_PROF
-    cout << str() << " " << timeAsUs(EventList::Get().now()) << " stats";
+    out << str() << " " << timeAsUs(EventList::Get().now()) << " stats";
 #else
-    cout << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
+    out << str() << " " << timeAsMs(EventList::Get().now()) << " stats";
 #endif
 
     for (auto it = counts.begin(); it != counts.end(); it++) {
-        cout << " " << it->first << "->" << it->second;
+        out << " " << it->first << "->" << it->second;
     }
-    cout << endl;
+    out << '\n';
 }
\ No newline at end of file
@@ -8,26 +8,38 @@
 #include "network.h"
 #include "loggertypes.h"
 
+#include <deque>
 #include <list>
 
+#define FF_HORIZON_US 3 // Default limit on how far ahead packets are fast-forwarded.
+
 class Queue : public EventSource, public PacketSink
 {
 public:
     Queue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger);
     void doNextEvent();
     virtual void receivePacket(Packet &pkt);
-    virtual void printStats();
+    virtual void printStats(std::ostream &out = std::cout);
 
     inline simtime_picosec drainTime(Packet *pkt) {
         return (simtime_picosec)(pkt->size()) * _ps_per_byte;
     }
 
+    inline linkspeed_bps bitrate() const { return _bitrate; }
+
+    // Bytes queued now, counting fast-forwarded packets still in the queue.
+    inline mem_b occupancy(simtime_picosec now) const {
+        return _queuesize + reservedBytes(now);
+    }
+
     inline mem_b serviceCapacity(simtime_picosec t) {
         return (mem_b)(timeAsSec(t) * (double)_bitrate);
     }
 
     inline mem_b dctcpThreshold() {
-        if (_bitrate <= 1000000000) { // 1gbps
+        if (_ecn_threshold > 0) {
+            return _ecn_threshold;
+        } else if (_bitrate <= 1000000000) { // 1gbps
             return 10 * MSS_BYTES;
         } else if (_bitrate <= 10000000000) { // 10gbps
             return 30 * MSS_BYTES;
@@ -36,8 +48,52 @@ public:
         }
     }
 
+    // ECN marking threshold of every queue in bytes, set in packets by
+    // --ecnthresh= (0: by line rate, as in dctcpThreshold).
+    static mem_b _ecn_threshold;
+
+    // Background traffic simulated as fluid (FluidNetwork, --hybrid=1)
+    // crossing this queue: rate bps of the line taken by it, and the bytes
+    // of it standing in the queue. Packets are then served at what is left
+    // of the line, behind the standing bytes, which also count towards
+    // drops, ECN marks and INT.
+    void setFluidLoad(double rate, mem_b backlog);
+
+    // Idle-path fast-forwarding (--fastforward=1). A packet that starts
+    // service with nobody queued behind it leaves at once: it is taken
+    // through this queue, its pipe and every following queue with no
+    // packets of its own, and put in the pipe before the first that has
+    // some, to come out at the time it would have. Each queue passed
+    // through keeps the packet's busy interval; packets that get there
+    // before it count it towards occupancy and wait for it, unless they
+    // are through before it starts. A packet that gets to a skipped queue
+    // before one fast-forwarded there may still be served after it, so a
+    // packet is only taken on while it is less than _ff_horizon ahead of
+    // now. Packets carrying INT are never fast-forwarded.
+    static bool _fast_forward;
+    static simtime_picosec _ff_horizon;
+
+    // Whether packets may pass through this queue without events when it's
+    // idle: FIFOs whose per-packet work, if any, is in onArrival.
+    virtual bool fastForwardable() const { return !_trim; }
+
+    // Per-packet work as pkt is queued, occupancy being the bytes queued
+    // with it. Fast-forwarding runs it for every queue passed through, at
+    // the time it takes the packet on rather than when it would arrive.
+    virtual void onArrival(Packet & /* pkt */, mem_b /* occupancy */) {}
+
+    // Packet trimming (NDP): data that doesn't fit is cut down to its
+    // header instead of dropped, and headers and control packets (acks,
+    // pulls) wait in their own FIFO, served ahead of data. Only the FIFO
+    // queues (Queue, LeafSwitch, CoreQueue) support it. Headers have their
+    // own budget, an eighth of _maxsize, taken out of what data may use, so
+    // the two together never exceed _maxsize.
+    inline void setTrimming(bool trim) { _trim = trim; }
+
     mem_b _maxsize;   // Maximum queue size.
     mem_b _queuesize; // Current queue size.
+    uint64_t _txBytes; // Bytes sent since the start.
+    uint64_t _nTrimmed; // Packets trimmed.
 
 protected:
     // Start serving the item at the head of the queue.
@@ -46,13 +102,85 @@ protected:
     // Wrap up serving the item at the head of the queue.
     virtual void completeService();
 
+    // Time to serve pkt. Without fluid load, its drainTime().
+    inline simtime_picosec serviceTime(Packet *pkt) {
+        simtime_picosec t = drainTime(pkt);
+        // The standing fluid backlog is ahead of whoever starts a busy
+        // period; the rest of the period queues behind that packet.
+        if (_fluid_backlog > 0 && _last_departure != EventList::Get().now()) {
+            t += _fluid_wait;
+        }
+        return t;
+    }
+
+    // Take pkt, the only packet queued, through the idle path ahead of it
+    // from its service start; false if it can't be (see _fast_forward).
+    bool fastForward(Packet &pkt, simtime_picosec start);
+
+    // Serve pkt, fast-forwarded and not queued, from start to the returned
+    // departure time, and keep that as a busy interval.
+    simtime_picosec passThrough(Packet &pkt, simtime_picosec arrival,
+                                simtime_picosec start, simtime_picosec service);
+
+    // When a packet taking service to serve may start if it arrives at
+    // arrival: after the fast-forwarded packets that came before it, in the
+    // first gap long enough among those that will come later.
+    simtime_picosec serviceStart(simtime_picosec arrival, simtime_picosec service);
+
+    // Forget the busy intervals over by now.
+    void dropReservations(simtime_picosec now);
+
+    // Bytes of fast-forwarded packets in the queue now.
+    mem_b reservedBytes(simtime_picosec now) const;
+
     // Apply ECN marking.
     void applyEcnMark(Packet &pkt);
 
+    // Count a departing packet, and stamp our state on it if it asks for INT.
+    void appendInt(Packet &pkt);
+
+    // Returns true if pkt doesn't fit and must be dropped. With trimming
+    // on, data that doesn't fit is trimmed and only dropped if the header
+    // FIFO is full too.
+    bool overflow(Packet &pkt);
+
+    // Queue an admitted packet.
+    void push(Packet &pkt);
+
+    inline bool idle() const { return _enqueued.empty() && _headers.empty(); }
+
+    inline bool isHeader(Packet &pkt) {
+        return _trim && (pkt.getFlag(Packet::ACK) || pkt.getFlag(Packet::TRIMMED));
+    }
+
+    // Bytes of _maxsize kept for headers.
+    inline mem_b headerBudget() const { return _trim ? _maxsize / 8 : 0; }
+
     std::list<Packet*> _enqueued;  // List of packet enqueued.
+    std::list<Packet*> _headers;   // Trimmed and control packets, if trimming.
+    mem_b _headersize;             // Bytes in _headers, part of _queuesize.
+    bool _trim;
+    bool _servingHeader;           // The packet in service is from _headers.
     linkspeed_bps _bitrate;       // Speed at which queue drains.
     simtime_picosec _ps_per_byte; // Service time, in picosec per byte.
 
+    // Fluid background load, see setFluidLoad().
+    double _fluid_rate;
+    mem_b _fluid_backlog;
+    simtime_picosec _fluid_wait;      // Line time of the backlog.
+    double _fluid_bytes;              // Fluid bytes sent before _fluid_since.
+    simtime_picosec _fluid_since;
+    simtime_picosec _last_departure;
+
+    // Busy intervals of fast-forwarded packets, in time order.
+    struct Reservation {
+        simtime_picosec arrival;
+        simtime_picosec from;
+        simtime_picosec until;
+        mem_b bytes;
+    };
+    std::deque<Reservation> _reserved;
+
     // Housekeeping
     QueueLogger *_logger;
 };
@@ -1,7 +1,8 @@
 #include "randomqueue.h"
 
 RandomQueue::RandomQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger, mem_b drop)
-    : Queue(bitrate, maxsize, logger), _drop(drop), _buffer_drops(0)
+    : Queue(bitrate, maxsize, logger), _drop(drop), _buffer_drops(0),
+    _rng(Rng::nameFor("randomqueue"))
 {
     _drop_th = _maxsize - _drop;
     _plr = 0.0;
@@ -19,7 +20,7 @@ RandomQueue::receivePacket(Packet &pkt)
     double drop_prob = 0;
     mem_b crt = _queuesize + pkt.size();
 
-    if (_plr > 0.0 && drand() < _plr) {
+    if (_plr > 0.0 && _rng.uniform() < _plr) {
         pkt.free();
         return;
     }
@@ -27,7 +28,7 @@ RandomQueue::receivePacket(Packet &pkt)
     if (crt > _drop_th)
         drop_prob = 1100.0 / _drop_th;
 
-    if (crt > _maxsize || drand() < drop_prob) {
+    if (crt > _maxsize || _rng.uniform() < drop_prob) {
         if (_logger) _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
         pkt.flow().logTraffic(pkt,*this,TrafficLogger::PKT_DROP);
 
@@ -5,18 +5,21 @@
  */
 
 #include "queue.h"
+#include "rng.h"
 
 class RandomQueue : public Queue
 {
 public:
     RandomQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger *logger, mem_b drop);
     void receivePacket(Packet &pkt);
+    bool fastForwardable() const { return false; }
     void set_packet_loss_rate(double v);
 
 private:
     mem_b _drop_th,_drop;
     int _buffer_drops;
     double _plr;
+    Rng _rng;
 };
 
 #endif
@@ -0,0 +1,310 @@
+/*
+ * RDMA transport
+ */
+#include "rdma.h"
+#include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+using namespace std;
+
+RdmaSrc::RdmaSrc(TrafficLogger *pktlogger,
+                 uint64_t flowsize,
+                 simtime_picosec duration)
+    : DataSource(pktlogger, flowsize, duration),
+      _state(IDLE),
+      _rate(10000000000),
+      _window(0),
+      _pace_next(0),
+      _rtt(0),
+      _rto(timeFromUs(INIT_RTO_US)),
+      _mdev(0),
+      _rto_timeout(0),
+      _min_rtt(ULLONG_MAX),
+      _nNacks(0),
+      _nTimeouts(0)
+{
+    // Constructor
+}
+
+void
+RdmaSrc::printStatus()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // bytes_transferred/total_bytes == time_elapsed/estimated_fct
+    simtime_picosec estimated_fct;
+    if (_last_acked > 0) {
+        estimated_fct = _flowsize * (current_ts - _start_time) / _last_acked;
+    } else {
+        estimated_fct = 0;
+    }
+
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
+         << " fct " << timeAsUs(estimated_fct)
+         << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time)
+         << " cc_rate " << _rate << '\n';
+}
+
+void
+RdmaSrc::doNextEvent()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // A new flow: the pacer clocks transmissions from here on, this event
+    // only watches the retransmission timer.
+    if (_state == IDLE) {
+        _state = NORMAL;
+        _pace_next = current_ts;
+        trySend();
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+        return;
+    }
+
+    // Cleanup the finished flow once nothing refers to it any more.
+    if (_state == FINISH) {
+        if (_flow._nPackets == 0 && !_pace_pending) {
+            delete _sink;
+            delete _route_fwd;
+            delete _route_rev;
+            delete this;
+            return;
+        }
+        EventList::Get().sourceIsPendingRel(*this, timeFromUs(MIN_RTO_US));
+        return;
+    }
+
+    // Retransmission timeout: go back to the first unacked byte.
+    if (_rto_timeout != 0 && current_ts >= _rto_timeout) {
+        OUTPUT(RTO) << str() << " at " << timeAsMs(current_ts)
+             << " RTO " << timeAsUs(_rto)
+             << " MDEV " << timeAsUs(_mdev)
+             << " RTT "<< timeAsUs(_rtt)
+             << " SEQ " << _last_acked
+             << " RTO_timeout " << timeAsMs(_rto_timeout)
+             << " RATE " << _rate << '\n';
+
+        _nTimeouts++;
+        _rto *= 2;
+        _rto_timeout = current_ts + _rto;
+        _highest_sent = _last_acked;
+        trySend();
+    }
+
+    // The timeout may move later while we wait; we then just wait again.
+    if (_rto_timeout != 0) {
+        EventList::Get().sourceIsPending(*this, _rto_timeout);
+    } else {
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+    }
+}
+
+void
+RdmaSrc::pacedSend()
+{
+    if (_state != NORMAL) {
+        return;
+    }
+
+    simtime_picosec current_ts = EventList::Get().now();
+    updateRate(current_ts);
+
+    if (!canSend()) {
+        return;
+    }
+
+    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, _highest_sent + 1, MSS_BYTES);
+    prepareData(*p);
+    p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
+    p->set_ts(current_ts);
+
+    _highest_sent += MSS_BYTES;
+    _packets_sent += MSS_BYTES;
+    p->sendOn();
+
+    if (_rto_timeout == 0) {
+        _rto_timeout = current_ts + _rto;
+    }
+
+    Pacer &pacer = Pacer::Get();
+    _pace_next = pacer.nextSendTime(_pace_next, timeFromSec((MSS_BYTES * 8.0) / _rate));
+    trySend();
+}
+
+void
+RdmaSrc::receivePacket(Packet &pkt)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    DataAck *p = (DataAck*)(&pkt);
+    DataAck::seq_t seqno = p->ackno();
+    simtime_picosec ts = p->ts();
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+
+    if (p->getFlag(Packet::CNP)) {
+        p->free();
+        if (_state == NORMAL) {
+            processCnp(current_ts);
+        }
+        return;
+    }
+
+    if (_state == FINISH) {
+        p->free();
+        return;
+    }
+
+    // Update rtt and rto estimates.
+    simtime_picosec new_rtt = current_ts - ts;
+
+    if (new_rtt < _min_rtt) {
+        _min_rtt = new_rtt;
+    }
+
+    if (_rtt > 0) {
+        uint64_t diff = (new_rtt > _rtt) ? (new_rtt - _rtt) : (_rtt - new_rtt);
+        _mdev = 3 * _mdev/4 + diff/4;
+        _rtt = 7 * _rtt/8 + new_rtt/8;
+    } else {
+        _rtt = new_rtt;
+        _mdev = new_rtt/2;
+    }
+
+    _rto = _rtt + 4 * _mdev;
+    if (_rto < timeFromUs(MIN_RTO_US)) {
+        _rto = timeFromUs(MIN_RTO_US);
+    }
+
+    processAck(*p, current_ts);
+
+    bool nack = p->getFlag(Packet::NACK);
+    p->free();
+
+    if ((_flowsize > 0 && seqno >= _flowsize) ||
+            (_duration > 0 && current_ts > _start_time + _duration)) {
+
+        if (_flowgen != NULL) {
+            _flowgen->finishFlow(id);
+        }
+        _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
+
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
+             << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
+             << " fct " << timeAsUs(current_ts - _start_time)
+             << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+             << " rate " << _flowsize * 8000.0 / (current_ts - _start_time)
+             << " nacks " << _nNacks
+             << " minrtt " << _min_rtt << '\n';
+
+        return;
+    }
+
+    if (seqno > _last_acked) {
+        _last_acked = seqno;
+        _rto_timeout = (seqno >= _highest_sent) ? 0 : current_ts + _rto;
+    }
+
+    // The receiver dropped everything after the hole; resend from there.
+    if (nack && seqno == _last_acked && seqno < _highest_sent) {
+        _nNacks++;
+        _highest_sent = seqno;
+    }
+
+    trySend();
+}
+
+bool
+RdmaSrc::canSend()
+{
+    if (_flowsize > 0 && _highest_sent >= _flowsize) {
+        return false;
+    }
+
+    // Always allow one packet in flight, however small the window.
+    uint64_t inflight = _highest_sent - _last_acked;
+    return _window == 0 || inflight == 0 || inflight + MSS_BYTES <= (uint64_t)_window;
+}
+
+void
+RdmaSrc::trySend()
+{
+    if (!_pace_pending && _state == NORMAL && canSend()) {
+        Pacer::Get().schedule(*this, _pace_next);
+    }
+}
+
+
+RdmaSink::RdmaSink(bool sendCnp)
+    : DataSink(),
+    _sendCnp(sendCnp),
+    _cnpSent(false),
+    _lastCnp(0),
+    _nacked(false)
+{}
+
+void
+RdmaSink::receivePacket(Packet &pkt)
+{
+    DataPacket *p = (DataPacket*)(&pkt);
+    DataPacket::seq_t seqno = p->seqno();
+
+    if (_sendCnp && p->getFlag(Packet::ECN_FWD)) {
+        sendCnp();
+    }
+
+    // Go-back-N: out-of-order data is dropped, and NACKed once per hole.
+    // The next expected packet trimmed on the way opens a hole too, one
+    // that is NACKed at once each time.
+    bool trimmedNext = p->getFlag(Packet::TRIMMED) && seqno == _cumulative_ack + 1;
+    bool inOrder = (seqno <= _cumulative_ack + 1) && !trimmedNext;
+    if (inOrder) {
+        if (seqno == _cumulative_ack + 1) {
+            _nacked = false;
+        }
+        processDataPacket(*p);
+    } else if (_nacked && !trimmedNext) {
+        pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+        p->free();
+        return;
+    }
+
+    DataAck *ack = DataAck::newpkt(_src->_flow, *_route, 1, _cumulative_ack);
+    ack->setFlag(Packet::ACK);
+    if (!inOrder) {
+        ack->setFlag(Packet::NACK);
+        _nacked = true;
+    }
+    ack->conga_info = p->conga_info;
+    ack->set_ts(p->ts());
+    ack->copyInt(*p);
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+    p->free();
+
+    ack->flow().logTraffic(*ack, *this, TrafficLogger::PKT_CREATESEND);
+    ack->sendOn();
+}
+
+void
+RdmaSink::sendCnp()
+{
+    simtime_picosec now = EventList::Get().now();
+    if (_cnpSent && now < _lastCnp + CNP_INTERVAL) {
+        return;
+    }
+    _cnpSent = true;
+    _lastCnp = now;
+
+    // Carries no ack and no CONGA feedback.
+    DataAck *cnp = DataAck::newpkt(_src->_flow, *_route, 1, _cumulative_ack);
+    cnp->setFlag(Packet::ACK);
+    cnp->setFlag(Packet::CNP);
+    cnp->conga_info = Packet::CongaInfo();
+    cnp->set_ts(now);
+
+    cnp->flow().logTraffic(*cnp, *this, TrafficLogger::PKT_CREATESEND);
+    cnp->sendOn();
+}
@@ -0,0 +1,92 @@
+/*
+ * RDMA transport header
+ */
+#ifndef RDMA_H
+#define RDMA_H
+
+#include "eventlist.h"
+#include "datasource.h"
+#include "pacer.h"
+
+#define CNP_INTERVAL timeFromUs(50) // At most one CNP per flow per interval.
+
+class RdmaSink;
+
+/*
+ * Common part of the rate-based RoCE endpoints (DCQCN, HPCC): a NIC-style
+ * reliable connection with go-back-N loss recovery, clocked by the shared
+ * Pacer at _rate and, if _window is set, limited to _window bytes in
+ * flight. Subclasses only implement congestion control, through the
+ * processAck/processCnp/updateRate hooks.
+ */
+class RdmaSrc : public DataSource, public PacedSource
+{
+    friend class RdmaSink;
+    public:
+        RdmaSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+                simtime_picosec duration = 0);
+
+        void printStatus();
+        void doNextEvent();
+        void receivePacket(Packet &pkt);
+        void pacedSend();
+
+        // Flow status.
+        enum FlowStatus {
+            IDLE,
+            NORMAL,
+            FINISH
+        } _state;
+
+        linkspeed_bps _rate; // Current sending rate.
+        mem_b _window;       // Bytes allowed in flight (0: no limit).
+        simtime_picosec _pace_next;
+
+        // RTT, RTO estimates.
+        simtime_picosec _rtt, _rto, _mdev;
+        simtime_picosec _rto_timeout;
+        simtime_picosec _min_rtt;
+
+        uint32_t _nNacks;   // Go-back-N retransmissions.
+        uint32_t _nTimeouts;
+
+    protected:
+        // Congestion control on a (non-CNP) ack, before it's freed.
+        virtual void processAck(DataAck & /* ack */, simtime_picosec /* now */) {}
+        virtual void processCnp(simtime_picosec /* now */) {}
+
+        // Called before every transmission, to run rate timers lazily.
+        virtual void updateRate(simtime_picosec /* now */) {}
+
+        // Tag outgoing data (e.g. to request telemetry).
+        virtual void prepareData(DataPacket & /* pkt */) {}
+
+        // Start the pacer if there is data and window to send.
+        void trySend();
+
+    private:
+        bool canSend();
+};
+
+/*
+ * RoCE receiver: acks every in-order packet, drops out-of-order ones and
+ * sends one NACK per hole, echoes telemetry and, if asked to, turns ECN
+ * marks into CNPs.
+ */
+class RdmaSink : public DataSink
+{
+    friend class RdmaSrc;
+    public:
+        RdmaSink(bool sendCnp);
+        void receivePacket(Packet &pkt);
+
+    private:
+        void sendCnp();
+
+        bool _sendCnp;
+        bool _cnpSent;
+        simtime_picosec _lastCnp;
+        bool _nacked;               // A NACK for the current hole is out.
+};
+
+#endif /* RDMA_H */
@@ -0,0 +1,269 @@
+/*
+ * Reorder buffer
+ */
+#include "reorder-buffer.h"
+
+using namespace std;
+
+ReorderBuffer::ReorderBuffer(uint32_t slotSize,
+                             uint32_t nSlots)
+    : _nReordered(0),
+    _maxDepth(0),
+    _sumDepth(0),
+    _slotSize(slotSize),
+    _nSlots(nSlots),
+    _bits((nSlots + 63) / 64, 0),
+    _head(0),
+    _base(0),
+    _nSlotsHeld(0)
+{
+    assert(nSlots > 0 && (nSlots & (nSlots - 1)) == 0);
+}
+
+inline bool
+ReorderBuffer::testSlot(uint32_t i) const
+{
+    return (_bits[i >> 6] >> (i & 63)) & 1;
+}
+
+inline void
+ReorderBuffer::setSlot(uint32_t i)
+{
+    _bits[i >> 6] |= (1ULL << (i & 63));
+}
+
+inline void
+ReorderBuffer::clearSlot(uint32_t i)
+{
+    _bits[i >> 6] &= ~(1ULL << (i & 63));
+}
+
+bool
+ReorderBuffer::add(seq_t seqno,
+                   mem_b size,
+                   seq_t next)
+{
+    assert(seqno > next);
+
+    // An empty ring can be re-based on the current hole for free.
+    if (_nSlotsHeld == 0) {
+        _base = next;
+        _head = 0;
+    }
+
+    if (size == _slotSize && seqno >= _base && (seqno - _base) % _slotSize == 0) {
+        uint64_t offset = (seqno - _base) / _slotSize;
+        if (offset < _nSlots) {
+            uint32_t i = (_head + offset) & (_nSlots - 1);
+            if (testSlot(i)) {
+                return false;
+            }
+            setSlot(i);
+            _nSlotsHeld++;
+            countReordered(seqno - next);
+            return true;
+        }
+    }
+
+    if (!addInterval(seqno, seqno + size)) {
+        return false;
+    }
+    countReordered(seqno - next);
+    return true;
+}
+
+void
+ReorderBuffer::countReordered(uint64_t depth)
+{
+    _nReordered++;
+    _sumDepth += depth;
+    if (depth > _maxDepth) {
+        _maxDepth = depth;
+    }
+}
+
+bool
+ReorderBuffer::addInterval(seq_t start,
+                           seq_t end)
+{
+    // Merge with a range that starts at or before us.
+    auto it = _intervals.upper_bound(start);
+    if (it != _intervals.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second >= end) {
+            return false;
+        }
+        if (prev->second >= start) {
+            start = prev->first;
+            _intervals.erase(prev);
+        }
+    }
+
+    // Swallow ranges that start inside us.
+    while (it != _intervals.end() && it->first <= end) {
+        end = max(end, it->second);
+        it = _intervals.erase(it);
+    }
+
+    _intervals[start] = end;
+    return true;
+}
+
+void
+ReorderBuffer::flushSlots()
+{
+    for (uint32_t k = 0; k < _nSlots && _nSlotsHeld > 0; k++) {
+        uint32_t i = (_head + k) & (_nSlots - 1);
+        if (testSlot(i)) {
+            clearSlot(i);
+            _nSlotsHeld--;
+            seq_t start = _base + (seq_t)k * _slotSize;
+            addInterval(start, start + _slotSize);
+        }
+    }
+    _head = 0;
+}
+
+mem_b
+ReorderBuffer::advance(seq_t next)
+{
+    seq_t pos = next;
+    bool progress = true;
+
+    while (progress && !empty()) {
+        progress = false;
+
+        if (_nSlotsHeld > 0) {
+            // Drop slots the cumulative ack has already passed.
+            while (_nSlotsHeld > 0 && _base + _slotSize <= pos) {
+                if (testSlot(_head)) {
+                    clearSlot(_head);
+                    _nSlotsHeld--;
+                }
+                _head = (_head + 1) & (_nSlots - 1);
+                _base += _slotSize;
+            }
+
+            if (_nSlotsHeld > 0 && _base != pos) {
+                if (_base < pos) {
+                    // Cumulative ack lands mid-slot; fall back to intervals.
+                    flushSlots();
+                }
+            } else {
+                while (_nSlotsHeld > 0 && testSlot(_head)) {
+                    clearSlot(_head);
+                    _nSlotsHeld--;
+                    _head = (_head + 1) & (_nSlots - 1);
+                    _base += _slotSize;
+                    pos += _slotSize;
+                    progress = true;
+                }
+            }
+        }
+
+        while (!_intervals.empty() && _intervals.begin()->first <= pos) {
+            auto it = _intervals.begin();
+            if (it->second > pos) {
+                pos = it->second;
+                progress = true;
+            }
+            _intervals.erase(it);
+        }
+    }
+
+    return pos - next;
+}
+
+bool
+ReorderBuffer::heldSlot(seq_t seq,
+                        uint32_t &k) const
+{
+    if (_nSlotsHeld == 0 || seq < _base || (seq - _base) / _slotSize >= _nSlots) {
+        return false;
+    }
+    k = (seq - _base) / _slotSize;
+    return testSlot((_head + k) & (_nSlots - 1));
+}
+
+bool
+ReorderBuffer::rangeAround(seq_t seqno,
+                           seq_t &start,
+                           seq_t &end) const
+{
+    start = end = seqno;
+
+    // Grow both ways a slot or an interval at a time until neither
+    // continues the range.
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        uint32_t k;
+
+        if (heldSlot(end, k)) {
+            end = _base + (seq_t)(k + 1) * _slotSize;
+            progress = true;
+        }
+        auto it = _intervals.upper_bound(end);
+        if (it != _intervals.begin() && std::prev(it)->second > end) {
+            end = std::prev(it)->second;
+            progress = true;
+        }
+
+        if (start > 0 && heldSlot(start - 1, k)) {
+            start = _base + (seq_t)k * _slotSize;
+            progress = true;
+        }
+        it = _intervals.lower_bound(start);
+        if (it != _intervals.begin() && std::prev(it)->second >= start) {
+            start = std::prev(it)->first;
+            progress = true;
+        }
+    }
+    return end > seqno;
+}
+
+void
+ReorderBuffer::ranges(vector<pair<seq_t,seq_t> > &out,
+                      uint32_t n) const
+{
+    out.clear();
+
+    // Walk the ring and the interval map together, merging as we go.
+    auto it = _intervals.begin();
+    uint32_t k = 0;
+    uint32_t nSlotsSeen = 0;
+
+    while (true) {
+        seq_t slotStart = ULLONG_MAX;
+        while (nSlotsSeen < _nSlotsHeld && k < _nSlots) {
+            if (testSlot((_head + k) & (_nSlots - 1))) {
+                slotStart = _base + (seq_t)k * _slotSize;
+                break;
+            }
+            k++;
+        }
+
+        seq_t start, end;
+        if (it != _intervals.end() && it->first <= slotStart) {
+            start = it->first;
+            end = it->second;
+            it++;
+        } else if (slotStart != ULLONG_MAX) {
+            start = slotStart;
+            end = slotStart + _slotSize;
+            nSlotsSeen++;
+            k++;
+        } else {
+            break;
+        }
+
+        if (!out.empty() && out.back().second >= start) {
+            out.back().second = max(out.back().second, end);
+        } else {
+            if (out.size() == n) {
+                break;
+            }
+            out.push_back(make_pair(start, end));
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/*
+ * Reorder buffer header
+ */
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+#include "htsim.h"
+
+#include <map>
+#include <vector>
+
+/*
+ * Out-of-order data held by a receiver above its cumulative ack.
+ *
+ * Senders cut a flow into MSS segments, so almost everything that arrives
+ * out of order sits at an MSS multiple past the first hole. Those segments
+ * are kept as one bit each in a ring indexed by (seq - base) / slotSize.
+ * Anything else -- odd sizes, misaligned retransmits, data too far ahead
+ * for the ring -- goes into an interval map of merged [start, end) byte
+ * ranges. Both make insert and advance O(1)/O(log n) instead of a list scan.
+ *
+ * Sequence numbers are byte numbers: a segment covers [seqno, seqno + size).
+ */
+class ReorderBuffer
+{
+    public:
+        typedef uint64_t seq_t;
+
+        ReorderBuffer(uint32_t slotSize = MSS_BYTES, uint32_t nSlots = 256);
+
+        // Hold a segment that arrived ahead of next, the first missing byte.
+        // Returns false if all of it was already held.
+        bool add(seq_t seqno, mem_b size, seq_t next);
+
+        // Release data contiguous with next; returns the number of bytes
+        // by which the cumulative ack can move forward.
+        mem_b advance(seq_t next);
+
+        bool empty() const { return _nSlotsHeld == 0 && _intervals.empty(); }
+
+        // Held byte ranges [start, end) in ascending order, at most n of them.
+        void ranges(std::vector<std::pair<seq_t,seq_t> > &out, uint32_t n) const;
+
+        // The held range [start, end) around byte seqno, found from seqno
+        // outwards rather than by a walk from the bottom. False if not held.
+        bool rangeAround(seq_t seqno, seq_t &start, seq_t &end) const;
+
+        /* Reorder statistics. */
+        uint32_t _nReordered;  // Segments newly held ahead of a hole.
+        uint64_t _maxDepth;    // Largest distance (bytes) from hole to segment.
+        uint64_t _sumDepth;
+
+    private:
+        inline bool testSlot(uint32_t i) const;
+        inline void setSlot(uint32_t i);
+        inline void clearSlot(uint32_t i);
+
+        // Move every held slot into the interval map and empty the ring.
+        void flushSlots();
+
+        bool addInterval(seq_t start, seq_t end);
+
+        // Count a newly held segment depth bytes past the hole.
+        void countReordered(uint64_t depth);
+
+        // Ring position of the slot holding byte seq, if it is held.
+        bool heldSlot(seq_t seq, uint32_t &k) const;
+
+        uint32_t _slotSize;
+        uint32_t _nSlots;           // Power of two.
+        std::vector<uint64_t> _bits;
+        uint32_t _head;             // Ring position of _base.
+        seq_t _base;                // First byte covered by the ring.
+        uint32_t _nSlotsHeld;
+
+        std::map<seq_t,seq_t> _intervals;
+};
+
+#endif /* REORDER_BUFFER_H */
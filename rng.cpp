@@ -0,0 +1,98 @@
+/*
+ * Random number generator
+ */
+#include "rng.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace std;
+
+uint64_t Rng::_seed = 0;
+
+// Components named so far, by kind, the names claimed and the shared
+// streams.
+static unordered_map<string,uint32_t> kindCounts;
+static unordered_set<string> claimedNames;
+static unordered_map<string,unique_ptr<Rng> > sharedStreams;
+
+static inline uint64_t
+splitmix64(uint64_t &x)
+{
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+Rng::Rng(const string &name)
+{
+    seed(_seed, streamOf(name));
+}
+
+Rng::Rng(uint64_t seed,
+         uint64_t stream)
+{
+    this->seed(seed, stream);
+}
+
+string
+Rng::nameFor(const string &kind)
+{
+    return claim(kind + "/" + to_string(kindCounts[kind]++));
+}
+
+const string &
+Rng::claim(const string &name)
+{
+    if (!claimedNames.insert(name).second) {
+        fprintf(stderr, "Random stream %s is claimed twice\n", name.c_str());
+        exit(1);
+    }
+    return name;
+}
+
+Rng&
+Rng::shared(const string &name)
+{
+    unique_ptr<Rng> &rng = sharedStreams[name];
+    if (!rng) {
+        rng.reset(new Rng(name));
+    }
+    return *rng;
+}
+
+uint64_t
+Rng::streamOf(const string &name)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (char c : name) {
+        h ^= (uint8_t)c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void
+Rng::seed(uint64_t seed,
+          uint64_t stream)
+{
+    // Mix the stream in first so that nearby seeds and streams still
+    // start far apart.
+    uint64_t x = seed;
+    uint64_t key = splitmix64(x) ^ stream;
+    x = key;
+    for (int i = 0; i < 4; i++) {
+        _s[i] = splitmix64(x);
+    }
+}
+
+void
+Rng::uniforms(double *out,
+              uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = uniform();
+    }
+}
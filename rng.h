@@ -0,0 +1,107 @@
+/*
+ * Random number generator header
+ */
+#ifndef RNG_H
+#define RNG_H
+
+#include "htsim.h"
+
+#include <string>
+
+#define RNG_UNIT (1.0 / 9007199254740992.0) // 2^-53: one step of uniform().
+
+/*
+ * xoshiro256** (Blackman and Vigna): 256 bits of state, period 2^256 - 1,
+ * a few ns per draw, and none of the shared state of libc rand().
+ *
+ * All randomness of a run is derived from its seed (--rngseed): every
+ * component that draws -- flow generator, workload, lossy queue, route
+ * builder -- has a stream of its own, named after it, and seeded by
+ * splitmix64 from the seed and a hash of the name. Draws in one component
+ * never shift another's; replicas differ by seed alone.
+ *
+ * A stream depends only on the seed and its name, so a component keeps
+ * its draws across runs exactly as long as it keeps its name. Route
+ * builders and generators given a prefix (setPrefix) have fixed names.
+ * Components without one -- random and exo queues, unprefixed flow
+ * generators and their workloads -- are numbered by nameFor in the order
+ * they are built, so adding or reordering one of a kind renumbers the
+ * ones after it. No two components may claim the same name.
+ */
+class Rng
+{
+    public:
+        // The stream called name, for the run's seed.
+        Rng(const std::string &name);
+        Rng(uint64_t seed, uint64_t stream);
+
+        // Seed of the run's streams. Set it before any are made.
+        static uint64_t _seed;
+
+        // A name for the next component of a kind: "kind/0", "kind/1"...,
+        // for components with no name of their own.
+        static std::string nameFor(const std::string &kind);
+
+        // Returns name, exiting if a component already claimed it: two
+        // components on one stream would draw identical values.
+        static const std::string &claim(const std::string &name);
+
+        // The stream called name, shared by everyone who asks for it (route
+        // builders, which are plain functions). Made on first use.
+        static Rng &shared(const std::string &name);
+
+        // Stream number of a name: its 64-bit FNV-1a hash.
+        static uint64_t streamOf(const std::string &name);
+
+        inline uint64_t next() {
+            uint64_t result = rotl(_s[1] * 5, 7) * 9;
+            uint64_t t = _s[1] << 17;
+            _s[2] ^= _s[0];
+            _s[3] ^= _s[1];
+            _s[1] ^= _s[2];
+            _s[0] ^= _s[3];
+            _s[2] ^= t;
+            _s[3] = rotl(_s[3], 45);
+            return result;
+        }
+
+        // Uniform in [0, 1), 53 bits.
+        inline double uniform() {
+            return (next() >> 11) * RNG_UNIT;
+        }
+
+        // Uniform in (0, 1], safe for log() and pow().
+        inline double uniformPos() {
+            return ((next() >> 11) + 1) * RNG_UNIT;
+        }
+
+        // Uniform in [0, n).
+        inline uint32_t below(uint32_t n) {
+            return (uint32_t)(((next() >> 32) * n) >> 32);
+        }
+
+        // Exponential with rate lambda (mean 1/lambda).
+        inline double exponential(double lambda) {
+            return -log(uniformPos()) / lambda;
+        }
+
+        // Pareto with the given shape (alpha) and mean.
+        inline double pareto(double alpha, double mean) {
+            double scale = (mean * (alpha - 1)) / alpha;
+            return scale / pow(uniformPos(), 1 / alpha);
+        }
+
+        // n draws of uniform() at once.
+        void uniforms(double *out, uint32_t n);
+
+    private:
+        static inline uint64_t rotl(uint64_t x, int k) {
+            return (x << k) | (x >> (64 - k));
+        }
+
+        void seed(uint64_t seed, uint64_t stream);
+
+        uint64_t _s[4];
+};
+
+#endif /* RNG_H */
@@ -0,0 +1,112 @@
+/*
+ * RPC generator
+ */
+#include "rpc-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+
+using namespace std;
+
+// Closed loop: the flow rate given to FlowGenerator goes unused.
+RpcGenerator::RpcGenerator(DataSource::EndHost endhost,
+                           route_gen_t rg,
+                           uint32_t nHosts,
+                           uint32_t clients,
+                           uint32_t outstanding,
+                           uint64_t requestSize,
+                           uint32_t avgResponseSize,
+                           Workloads::FlowDist responseSizeDist,
+                           simtime_picosec thinkTime)
+    : FlowGenerator(endhost, rg, speedFromGbps(1), avgResponseSize, responseSizeDist),
+    _nHosts(nHosts),
+    _outstanding(outstanding),
+    _requestSize(requestSize),
+    _thinkTime(thinkTime),
+    _startTime(0),
+    _nRpcs(0)
+{
+    if (clients == 0 || clients >= nHosts) {
+        fprintf(stderr, "RPC clients %u needs 1 to %u hosts\n", clients, nHosts - 1);
+        exit(1);
+    }
+
+    // The first hosts of a partial shuffle.
+    vector<uint32_t> hosts(nHosts);
+    for (uint32_t i = 0; i < nHosts; i++) {
+        hosts[i] = i;
+    }
+    for (uint32_t i = 0; i < clients; i++) {
+        swap(hosts[i], hosts[i + _rng.below(nHosts - i)]);
+    }
+    _clients.assign(hosts.begin(), hosts.begin() + clients);
+
+    setStartJitter(0);
+}
+
+void
+RpcGenerator::doNextEvent()
+{
+    simtime_picosec now = EventList::Get().now();
+
+    if (now == _endTime) {
+        double secs = timeAsSec(_endTime - _startTime);
+        OUTPUT(SUMMARY) << "RPC clients " << _clients.size() << " outstanding " << _outstanding
+                        << " completed " << _nRpcs << " rps " << (secs > 0 ? _nRpcs / secs : 0) << '\n';
+        dumpLiveFlows();
+        return;
+    }
+
+    // Every client fills its window; completions keep it full from here.
+    _startTime = now;
+    for (uint32_t client : _clients) {
+        for (uint32_t k = 0; k < _outstanding; k++) {
+            startRpc(client, 0);
+        }
+    }
+}
+
+void
+RpcGenerator::startRpc(uint32_t client,
+                       simtime_picosec delay)
+{
+    Rpc rpc;
+    rpc.client = client;
+    rpc.server = _rng.below(_nHosts - 1);
+    if (rpc.server >= client) {
+        rpc.server++;
+    }
+    rpc.start = EventList::Get().now() + delay;
+    rpc.response = false;
+
+    _rpcs[createFlow(_requestSize, delay, client, rpc.server)] = rpc;
+}
+
+void
+RpcGenerator::finishFlow(uint32_t flow_id)
+{
+    FlowGenerator::finishFlow(flow_id);
+
+    auto it = _rpcs.find(flow_id);
+    if (it == _rpcs.end()) {
+        return;
+    }
+
+    Rpc rpc = it->second;
+    _rpcs.erase(it);
+
+    // Request served: the response goes back.
+    if (!rpc.response) {
+        rpc.response = true;
+        _rpcs[createFlow(_workload.generateFlowSize(), 0, rpc.server, rpc.client)] = rpc;
+        return;
+    }
+
+    simtime_picosec now = EventList::Get().now();
+    FctStats::Get().recordCompletion("RPC", now - rpc.start);
+    _nRpcs++;
+
+    if (now < _endTime) {
+        simtime_picosec think = _thinkTime > 0 ? llround(_rng.exponential(1.0 / _thinkTime)) : 0;
+        startRpc(rpc.client, think);
+    }
+}
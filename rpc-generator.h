@@ -0,0 +1,56 @@
+/*
+ * RPC generator header
+ */
+#ifndef RPC_GENERATOR_H
+#define RPC_GENERATOR_H
+
+#include "flow-generator.h"
+
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Closed-loop request/response traffic: each of a number of clients,
+ * picked at random, keeps a fixed number of RPCs outstanding. An RPC is a
+ * requestSize flow to a random server, then, once that completes, a
+ * response flow back of a size from the workload distribution. When the
+ * response completes the RPC's latency goes to FctStats ("RPC") and, after
+ * an exponential think time (mean thinkTime, none if 0), the client issues
+ * the next one. Offered load follows from how fast RPCs complete, not
+ * from a rate.
+ */
+class RpcGenerator : public FlowGenerator
+{
+    public:
+        RpcGenerator(DataSource::EndHost endhost, route_gen_t rg, uint32_t nHosts,
+                uint32_t clients, uint32_t outstanding, uint64_t requestSize,
+                uint32_t avgResponseSize, Workloads::FlowDist responseSizeDist,
+                simtime_picosec thinkTime);
+        void doNextEvent();
+        void finishFlow(uint32_t flow_id);
+
+    private:
+        // Issues an RPC from the client host, starting after delay.
+        void startRpc(uint32_t client, simtime_picosec delay);
+
+        uint32_t _nHosts;
+        std::vector<uint32_t> _clients; // Hosts of the clients.
+        uint32_t _outstanding;
+        uint64_t _requestSize;
+        simtime_picosec _thinkTime;
+
+        struct Rpc {
+            uint32_t client;
+            uint32_t server;
+            simtime_picosec start;    // Of the request.
+            bool response;            // The flow is the response.
+        };
+
+        // RPCs in progress, by the id of their current flow.
+        std::unordered_map<uint32_t,Rpc> _rpcs;
+
+        simtime_picosec _startTime;
+        uint64_t _nRpcs;              // RPCs completed.
+};
+
+#endif /* RPC_GENERATOR_H */
@@ -0,0 +1,86 @@
+/*
+ * Distribution sampling
+ */
+#include "sampler.h"
+
+using namespace std;
+
+void
+AliasTable::build(const vector<double> &weights)
+{
+    uint32_t n = weights.size();
+    assert(n > 0);
+
+    double sum = 0;
+    for (double w : weights) {
+        sum += w;
+    }
+    assert(sum > 0);
+
+    // Columns under the average lend to those over it until all are full.
+    vector<double> scaled(n);
+    vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; i++) {
+        scaled[i] = weights[i] * n / sum;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    _prob.assign(n, UINT32_MAX);
+    _alias.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        _alias[i] = i;
+    }
+
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        uint32_t l = large.back();
+        small.pop_back();
+
+        _prob[s] = (uint32_t)(scaled[s] * 4294967296.0);
+        _alias[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Whatever is left is full up to rounding.
+}
+
+void
+CdfSampler::build(const double *probs,
+                  const uint64_t *values,
+                  uint32_t n)
+{
+    assert(n >= 2);
+
+    vector<double> mass;
+    _base.clear();
+    _width.clear();
+    _mean = 0;
+
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        double p = probs[i + 1] - probs[i];
+        if (p <= 0) {
+            continue;
+        }
+        assert(values[i + 1] >= values[i]);
+
+        mass.push_back(p);
+        _base.push_back(values[i]);
+        _width.push_back((double)(values[i + 1] - values[i]));
+        _mean += p * (values[i] + values[i + 1]) / 2.0;
+    }
+    _mean /= probs[n - 1] - probs[0];
+    _segments.build(mass);
+}
+
+void
+CdfSampler::sample(Rng &rng,
+                   uint64_t *out,
+                   uint32_t n) const
+{
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = sample(rng);
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Distribution sampling header
+ */
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "rng.h"
+
+#include <vector>
+
+/*
+ * Walker's alias method (Vose's construction): picks index i of n with
+ * probability weights[i] / sum(weights) in O(1), from one draw -- the high
+ * half picks a column, the low half whether to take it or its alias.
+ */
+class AliasTable
+{
+    public:
+        AliasTable() {}
+        AliasTable(const std::vector<double> &weights) { build(weights); }
+
+        void build(const std::vector<double> &weights);
+
+        inline uint32_t sample(Rng &rng) const {
+            uint64_t x = rng.next();
+            uint32_t i = (uint32_t)(((x >> 32) * _prob.size()) >> 32);
+            return (uint32_t)x < _prob[i] ? i : _alias[i];
+        }
+
+        uint32_t size() const { return _prob.size(); }
+
+    private:
+        // Chance to keep column i, scaled to 2^32, and what to take if not.
+        std::vector<uint32_t> _prob;
+        std::vector<uint32_t> _alias;
+};
+
+/*
+ * A distribution given by points (p_i, v_i) of its CDF, sampled as the
+ * piecewise-linear interpolation between them: a segment is picked by its
+ * probability mass from an alias table, then a value uniformly within it.
+ * Segments are kept in flat arrays, so a sample is two draws and no search.
+ */
+class CdfSampler
+{
+    public:
+        CdfSampler() : _mean(0) {}
+
+        // probs rising from 0 to 1, values non-decreasing; n points.
+        void build(const double *probs, const uint64_t *values, uint32_t n);
+
+        bool empty() const { return _base.empty(); }
+
+        inline uint64_t sample(Rng &rng) const {
+            uint32_t s = _segments.sample(rng);
+            return _base[s] + (uint64_t)(_width[s] * rng.uniform());
+        }
+
+        // n samples at once.
+        void sample(Rng &rng, uint64_t *out, uint32_t n) const;
+
+        // Exact mean of the interpolated distribution.
+        double mean() const { return _mean; }
+
+    private:
+        AliasTable _segments;
+        std::vector<uint64_t> _base;    // Segment start value.
+        std::vector<double> _width;     // Segment end less start value.
+        double _mean;
+};
+
+#endif /* SAMPLER_H */
@@ -35,7 +35,7 @@ StocFairQueue::beginService()
                 break;
             }
         }
-        EventList::Get().sourceIsPendingRel(*this, drainTime(_packets[queue].back()));
+        EventList::Get().sourceIsPendingRel(*this, serviceTime(_packets[queue].back()));
     }
 }
 
@@ -67,6 +67,7 @@ StocFairQueue::completeService()
     }
 
     applyEcnMark(*pkt);
+    appendInt(*pkt);
     pkt->sendOn();
 
     beginService();
@@ -156,6 +157,6 @@ StocFairQueue::hashFlow(int index, uint32_t flowid)
 }
 
 void
-StocFairQueue::printStats()
+StocFairQueue::printStats(ostream &)
 {
 }
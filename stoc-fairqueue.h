@@ -13,7 +13,8 @@ public:
     StocFairQueue(linkspeed_bps bitrate, mem_b maxsize,
             QueueLogger *logger, uint32_t nQueue = 32, uint32_t quantum = MSS_BYTES);
     void receivePacket(Packet &pkt);
-    void printStats();
+    bool fastForwardable() const { return false; }
+    void printStats(std::ostream &out);
 
 protected:
     void beginService();
@@ -0,0 +1,389 @@
+/*
+ * Swift
+ */
+#include "swift.h"
+#include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
+#include "queue.h"
+
+using namespace std;
+
+simtime_picosec SwiftSrc::_base_target = timeFromUs(10);
+
+SwiftSrc::SwiftSrc(TrafficLogger *pktlogger,
+                   uint64_t flowsize,
+                   simtime_picosec duration)
+    : DataSource(pktlogger, flowsize, duration),
+      _state(IDLE),
+      _cwnd(SWIFT_INIT_CWND),
+      _fabric_cwnd(SWIFT_INIT_CWND),
+      _endpoint_cwnd(SWIFT_INIT_CWND),
+      _hops(0),
+      _recover_seq(0),
+      _dupacks(0),
+      _retx_cnt(0),
+      _drops(0),
+      _rtt(0),
+      _rto(timeFromUs(INIT_RTO_US)),
+      _mdev(0),
+      _rto_timeout(0),
+      _min_rtt(ULLONG_MAX),
+      _last_decrease(0),
+      _pace_next(0),
+      _fabric_delay(0),
+      _host_delay(0)
+{
+    // Constructor
+}
+
+void
+SwiftSrc::printStatus()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // bytes_transferred/total_bytes == time_elapsed/estimated_fct
+    simtime_picosec estimated_fct;
+    if (_last_acked > 0) {
+        estimated_fct = _flowsize * (current_ts - _start_time) / _last_acked;
+    } else {
+        estimated_fct = 0;
+    }
+
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+         << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
+         << " fct " << timeAsUs(estimated_fct)
+         << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time)
+         << " cwnd " << _cwnd << '\n';
+}
+
+void
+SwiftSrc::doNextEvent()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // A new flow: count the switch hops, then start sending.
+    if (_state == IDLE) {
+        uint32_t nQueues = 0;
+        for (PacketSink *hop : *_route_fwd) {
+            if (dynamic_cast<Queue*>(hop)) {
+                nQueues++;
+            }
+        }
+        _hops = (nQueues > 0) ? nQueues - 1 : 0;
+
+        _state = NORMAL;
+        _pace_next = current_ts;
+        sendPackets();
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+        return;
+    }
+
+    // Cleanup the finished flow once nothing refers to it any more.
+    if (_state == FINISH) {
+        if (_flow._nPackets == 0 && !_pace_pending) {
+            delete _sink;
+            delete _route_fwd;
+            delete _route_rev;
+            delete this;
+            return;
+        }
+        EventList::Get().sourceIsPendingRel(*this, timeFromUs(MIN_RTO_US));
+        return;
+    }
+
+    // Retransmission timeout.
+    if (_rto_timeout != 0 && current_ts >= _rto_timeout) {
+        OUTPUT(RTO) << str() << " at " << timeAsMs(current_ts)
+             << " RTO " << timeAsUs(_rto)
+             << " MDEV " << timeAsUs(_mdev)
+             << " RTT "<< timeAsUs(_rtt)
+             << " SEQ " << _last_acked
+             << " CWND " << _cwnd
+             << " RTO_timeout " << timeAsMs(_rto_timeout)
+             << " STATE " << _state << '\n';
+
+        _retx_cnt++;
+        if (_retx_cnt >= SWIFT_RETX_RESET) {
+            _fabric_cwnd = SWIFT_MIN_CWND;
+            _endpoint_cwnd = SWIFT_MIN_CWND;
+            clampWindow();
+        } else {
+            decreaseWindow(1 - SWIFT_MAX_MDF);
+        }
+
+        _state = NORMAL;
+        _dupacks = 0;
+        _recover_seq = _highest_sent;
+        _highest_sent = _last_acked + MSS_BYTES;
+
+        _rto *= 2;
+        _rto_timeout = current_ts + _rto;
+
+        sendSegment(_last_acked);
+    }
+
+    // The timeout may move later while we wait; we then just wait again.
+    if (_rto_timeout != 0) {
+        EventList::Get().sourceIsPending(*this, _rto_timeout);
+    } else {
+        EventList::Get().sourceIsPendingRel(*this, _rto);
+    }
+}
+
+void
+SwiftSrc::pacedSend()
+{
+    sendPackets();
+}
+
+void
+SwiftSrc::receivePacket(Packet &pkt)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+    DataAck *p = (DataAck*)(&pkt);
+    DataAck::seq_t seqno = p->ackno();
+    simtime_picosec ts = p->ts();
+
+    // Host delay: from sending the packet to the end of its transmission
+    // by the NIC, less the transmission itself.
+    simtime_picosec host_delay = 0;
+    if (p->nIntHops() > 0) {
+        const Packet::IntHop &nic = p->intHop(0);
+        simtime_picosec serialization = timeFromSec(MSS_BYTES * 8.0 / nic.bitrate);
+        if (nic.ts > ts + serialization) {
+            host_delay = nic.ts - ts - serialization;
+        }
+    }
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+    p->free();
+
+    if (_state == FINISH) {
+        return;
+    }
+
+    if ((_flowsize > 0 && seqno >= _flowsize) ||
+            (_duration > 0 && current_ts > _start_time + _duration)) {
+
+        if (_flowgen != NULL) {
+            _flowgen->finishFlow(id);
+        }
+        _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
+
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
+             << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
+             << " fct " << timeAsUs(current_ts - _start_time)
+             << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
+             << " rate " << _flowsize * 8000.0 / (current_ts - _start_time)
+             << " cwnd " << _cwnd
+             << " hops " << _hops
+             << " minrtt " << _min_rtt << '\n';
+
+        return;
+    }
+
+    // Delayed / reordered ack.
+    if (seqno < _last_acked) {
+        return;
+    }
+
+    // Update rtt and rto estimates.
+    simtime_picosec new_rtt = current_ts - ts;
+
+    if (new_rtt < _min_rtt) {
+        _min_rtt = new_rtt;
+    }
+
+    if (_rtt > 0) {
+        uint64_t diff = (new_rtt > _rtt) ? (new_rtt - _rtt) : (_rtt - new_rtt);
+        _mdev = 3 * _mdev/4 + diff/4;
+        _rtt = 7 * _rtt/8 + new_rtt/8;
+    } else {
+        _rtt = new_rtt;
+        _mdev = new_rtt/2;
+    }
+
+    _rto = _rtt + 4 * _mdev;
+    if (_rto < timeFromUs(MIN_RTO_US)) {
+        _rto = timeFromUs(MIN_RTO_US);
+    }
+
+    _host_delay = host_delay;
+    _fabric_delay = (new_rtt > host_delay) ? new_rtt - host_delay : 0;
+
+    // A new ack.
+    if (seqno > _last_acked) {
+        double acked = (double)(seqno - _last_acked) / MSS_BYTES;
+        _last_acked = seqno;
+        _retx_cnt = 0;
+        _rto_timeout = (seqno >= _highest_sent) ? 0 : current_ts + _rto;
+
+        bool canDecrease = (current_ts - _last_decrease >= _rtt);
+        bool decreased = updateWindow(_fabric_cwnd, _fabric_delay, targetDelay(), acked, canDecrease);
+        decreased |= updateWindow(_endpoint_cwnd, _host_delay, SWIFT_ENDPOINT_TARGET, acked, canDecrease);
+        if (decreased) {
+            _last_decrease = current_ts;
+        }
+        clampWindow();
+
+        if (_state == RECOVERY) {
+            if (seqno >= _recover_seq) {
+                _state = NORMAL;
+                _dupacks = 0;
+            } else {
+                // Partial ack: the next hole is lost too.
+                sendSegment(_last_acked);
+            }
+        } else {
+            _dupacks = 0;
+        }
+
+        sendPackets();
+        return;
+    }
+
+    // A dup ack.
+    _dupacks++;
+    if (_state == RECOVERY || _dupacks != 3 || _last_acked < _recover_seq) {
+        return;
+    }
+
+    // Fast retransmit.
+    _drops++;
+    if (current_ts - _last_decrease >= _rtt) {
+        decreaseWindow(1 - SWIFT_MAX_MDF);
+    }
+    _state = RECOVERY;
+    _recover_seq = _highest_sent;
+    sendSegment(_last_acked);
+}
+
+simtime_picosec
+SwiftSrc::targetDelay()
+{
+    // Flow-based scaling: fs_range at fs_min_cwnd, down to 0 at fs_max_cwnd.
+    double fsRange = 5.0 * _base_target;
+    double alpha = fsRange / (1 / sqrt(SWIFT_FS_MIN_CWND) - 1 / sqrt(SWIFT_FS_MAX_CWND));
+    double beta = -alpha / sqrt(SWIFT_FS_MAX_CWND);
+    double fs = min(max(alpha / sqrt(_fabric_cwnd) + beta, 0.0), fsRange);
+
+    return _base_target + _hops * SWIFT_HOP_SCALE + llround(fs);
+}
+
+bool
+SwiftSrc::updateWindow(double &cwnd,
+                       simtime_picosec delay,
+                       simtime_picosec target,
+                       double acked,
+                       bool canDecrease)
+{
+    if (delay < target) {
+        if (cwnd >= 1) {
+            cwnd += SWIFT_AI / cwnd * acked;
+        } else {
+            cwnd += SWIFT_AI * acked;
+        }
+        return false;
+    }
+
+    if (!canDecrease) {
+        return false;
+    }
+
+    double excess = (double)(delay - target) / delay;
+    cwnd *= max(1 - SWIFT_BETA * excess, 1 - SWIFT_MAX_MDF);
+    return true;
+}
+
+void
+SwiftSrc::decreaseWindow(double factor)
+{
+    _fabric_cwnd *= factor;
+    _endpoint_cwnd *= factor;
+    _last_decrease = EventList::Get().now();
+    clampWindow();
+}
+
+void
+SwiftSrc::clampWindow()
+{
+    _fabric_cwnd = min(max(_fabric_cwnd, SWIFT_MIN_CWND), SWIFT_MAX_CWND);
+    _endpoint_cwnd = min(max(_endpoint_cwnd, SWIFT_MIN_CWND), SWIFT_MAX_CWND);
+    _cwnd = min(_fabric_cwnd, _endpoint_cwnd);
+}
+
+void
+SwiftSrc::sendPackets()
+{
+    if (_state == IDLE || _state == FINISH) {
+        return;
+    }
+
+    simtime_picosec current_ts = EventList::Get().now();
+
+    while (_flowsize == 0 || _highest_sent < _flowsize) {
+        if (_cwnd >= 1) {
+            if (_highest_sent - _last_acked + MSS_BYTES > _cwnd * MSS_BYTES) {
+                break;
+            }
+        } else {
+            // Below one packet: one every rtt / cwnd.
+            if (current_ts < _pace_next) {
+                if (!_pace_pending) {
+                    Pacer::Get().schedule(*this, _pace_next);
+                }
+                break;
+            }
+            simtime_picosec rtt = (_rtt != 0) ? _rtt : timeFromUs(MIN_RTO_US);
+            _pace_next = Pacer::Get().nextSendTime(_pace_next, llround(rtt / _cwnd));
+        }
+
+        sendSegment(_highest_sent);
+    }
+}
+
+void
+SwiftSrc::sendSegment(uint64_t seqno)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, seqno + 1, MSS_BYTES);
+    p->setFlag(Packet::INT);
+    p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
+    p->set_ts(current_ts);
+
+    if (seqno == _highest_sent) {
+        _highest_sent += MSS_BYTES;
+    }
+    _packets_sent += MSS_BYTES;
+    p->sendOn();
+
+    if (_rto_timeout == 0) {
+        _rto_timeout = current_ts + _rto;
+    }
+}
+
+
+SwiftSink::SwiftSink() : DataSink() {}
+
+void
+SwiftSink::receivePacket(Packet &pkt)
+{
+    DataPacket *p = (DataPacket*)(&pkt);
+    processDataPacket(*p);
+
+    DataAck *ack = DataAck::newpkt(_src->_flow, *_route, 1, _cumulative_ack);
+    ack->setFlag(Packet::ACK);
+    ack->conga_info = p->conga_info;
+    ack->set_ts(p->ts());
+    ack->copyInt(*p);
+
+    pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
+    p->free();
+
+    ack->flow().logTraffic(*ack, *this, TrafficLogger::PKT_CREATESEND);
+    ack->sendOn();
+}
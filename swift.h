@@ -0,0 +1,106 @@
+/*
+ * Swift header
+ */
+#ifndef SWIFT_H
+#define SWIFT_H
+
+#include "eventlist.h"
+#include "datasource.h"
+#include "pacer.h"
+
+#define SWIFT_INIT_CWND       10.0   // Packets.
+#define SWIFT_AI              1.0    // Additive increase, packets per RTT.
+#define SWIFT_BETA            0.8    // Multiplicative decrease gain.
+#define SWIFT_MAX_MDF         0.5    // Largest cut per decrease.
+#define SWIFT_HOP_SCALE       timeFromUs(1)  // Target delay added per switch hop.
+#define SWIFT_FS_MIN_CWND     0.1    // Flow scaling range, in packets.
+#define SWIFT_FS_MAX_CWND     100.0
+#define SWIFT_MIN_CWND        0.001
+#define SWIFT_MAX_CWND        1000.0
+#define SWIFT_RETX_RESET      5      // Consecutive RTOs before cwnd drops to the minimum.
+#define SWIFT_ENDPOINT_TARGET timeFromUs(5)  // Target delay at the sending NIC.
+
+class SwiftSink;
+class FlowGenerator;
+
+/*
+ * Swift (Kumar et al., SIGCOMM 2020). Two delay-driven windows, in
+ * packets: the fabric window reacts to RTT minus the time spent at the
+ * host, against a target that grows with the number of switch hops and,
+ * for small windows, with 1/sqrt(cwnd) so that many flows can share a
+ * link; the endpoint window reacts to delay at the sending NIC. The
+ * smaller one is used. Below one packet the window becomes a pacing
+ * interval of rtt / cwnd, clocked by the shared Pacer.
+ *
+ * Host delay comes from in-band telemetry: data packets ask for INT and
+ * the first queue on the route, the NIC, stamps when the packet left it.
+ * The hop count is the number of queues on the route past the NIC.
+ */
+class SwiftSrc : public DataSource, public PacedSource
+{
+    friend class SwiftSink;
+    public:
+        SwiftSrc(TrafficLogger *pktlogger, uint64_t flowsize = 0,
+                 simtime_picosec duration = 0);
+
+        void printStatus();
+        void doNextEvent();
+        void receivePacket(Packet &pkt);
+        void pacedSend();
+
+        // Base fabric target delay, before hop and flow scaling.
+        static simtime_picosec _base_target;
+
+        // Flow status.
+        enum FlowStatus {
+            IDLE,
+            NORMAL,
+            RECOVERY,
+            FINISH
+        } _state;
+
+        // Congestion windows, in packets.
+        double _cwnd;
+        double _fabric_cwnd;
+        double _endpoint_cwnd;
+
+        uint32_t _hops;
+        uint64_t _recover_seq;
+        uint16_t _dupacks;
+        uint32_t _retx_cnt;  // RTOs since the last new ack.
+        uint32_t _drops;
+
+        // RTT, RTO estimates.
+        simtime_picosec _rtt, _rto, _mdev;
+        simtime_picosec _rto_timeout;
+        simtime_picosec _min_rtt;
+        simtime_picosec _last_decrease;
+        simtime_picosec _pace_next;
+
+        // Last delay samples.
+        simtime_picosec _fabric_delay;
+        simtime_picosec _host_delay;
+
+    private:
+        simtime_picosec targetDelay();
+
+        // Additive increase below the target, multiplicative decrease
+        // (at most once per RTT) above it. Returns true if it decreased.
+        bool updateWindow(double &cwnd, simtime_picosec delay, simtime_picosec target,
+                          double acked, bool canDecrease);
+        void decreaseWindow(double factor);
+        void clampWindow();
+
+        void sendPackets();
+        void sendSegment(uint64_t seqno);
+};
+
+class SwiftSink : public DataSink
+{
+    friend class SwiftSrc;
+    public:
+        SwiftSink();
+        void receivePacket(Packet &pkt);
+};
+
+#endif /* SWIFT_H */
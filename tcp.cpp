@@ -3,6 +3,8 @@
  */
 #include "tcp.h"
 #include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
 #include "prof.h"
 #include <testbed/switch/leafswitch.h>
 
@@ -11,8 +13,13 @@
 using namespace std;
 
 bool TcpSrc::_enable_dctcp = false;
+bool TcpSrc::_enable_pfabric = false;
+bool TcpSrc::_enable_sack = false;
+bool TcpSrc::_enable_pacing = false;
 map<uint64_t, uint64_t> TcpSrc::slacks;
 map<uint64_t, uint64_t> TcpSink::slacks;
+uint32_t TcpSink::_delack_segments = 1;
+simtime_picosec TcpSink::_delack_timeout = timeFromUs(50);
 uint64_t TcpSrc::totalPkts = 0;
 uint64_t TcpSink::totalPkts = 0;
 
@@ -35,6 +42,8 @@ TcpSrc::TcpSrc(TcpLogger *logger,
                _marked_pkts(0),
                _total_pkts(0),
                _dctcp_cwnd(0),
+               _high_rxt(0),
+               _pace_next(0),
                _logger(logger)
 {
     // Constructor
@@ -53,14 +62,14 @@ TcpSrc::printStatus()
         estimated_fct = 0;
     }
 
-    cout << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
          << " start " << lround(timeAsUs(_start_time))
          << " endBytes " << _last_acked
          << " fct " << timeAsUs(estimated_fct)
          << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
          << " rate " << _last_acked * 8000.0 / (current_ts - _start_time)
          << " cwnd " << _cwnd
-         << " alpha " << _alpha << endl;
+         << " alpha " << _alpha << '\n';
 }
 
 void
@@ -72,6 +81,11 @@ TcpSrc::doNextEvent()
     if (_state == IDLE) {
         _state = SLOW_START;
         _cwnd = 2 * MSS_BYTES;
+        if (_enable_pfabric) {
+            _cwnd = PFABRIC_INIT_CWND * MSS_BYTES;
+            _ssthresh = _cwnd;
+            _rto = timeFromUs(PFABRIC_RTO_US);
+        }
         _dctcp_cwnd = _cwnd;
         sendPackets();
     }
@@ -80,7 +94,9 @@ TcpSrc::doNextEvent()
     else if (_state == FINISH) {
         // If no more flow packets in the system, delete all objects.
         // Make sure no one else has access to these.
-        if (_flow._nPackets == 0) {
+        // The sink's delayed ack timer must not fire on a deleted sink,
+        // nor the pacer on a deleted source.
+        if (_flow._nPackets == 0 && !((TcpSink*)_sink)->_timer_pending && !_pace_pending) {
             delete _sink;
             delete _route_fwd;
             delete _route_rev;
@@ -92,14 +108,14 @@ TcpSrc::doNextEvent()
     // Retransmission timeout.
     else if (_RFC2988_RTO_timeout != 0 && current_ts >= _RFC2988_RTO_timeout) {
 
-        cout << str() << " at " << timeAsMs(current_ts)
+        OUTPUT(RTO) << str() << " at " << timeAsMs(current_ts)
              << " RTO " << timeAsUs(_rto)
              << " MDEV " << timeAsUs(_mdev)
              << " RTT "<< timeAsUs(_rtt)
              << " SEQ " << _last_acked / MSS_BYTES
              << " CWND "<< _cwnd / MSS_BYTES
              << " RTO_timeout " << timeAsMs(_RFC2988_RTO_timeout)
-             << " STATE " << _state << endl;
+             << " STATE " << _state << '\n';
 
         if (_logger) _logger->logTcp(*this, TcpLogger::TCP_TIMEOUT);
 
@@ -115,9 +131,12 @@ TcpSrc::doNextEvent()
         _recover_seq = _highest_sent;
         _highest_sent = _last_acked + MSS_BYTES;
         _dupacks = 0;
+        _sacked.clear();
 
         // Reset rtx timerRFC 2988 5.5 & 5.6
-        _rto *= 2;
+        if (!_enable_pfabric) {
+            _rto *= 2;
+        }
         _RFC2988_RTO_timeout = current_ts + _rto;
 
         retransmitPacket(1);
@@ -138,6 +157,7 @@ TcpSrc::receivePacket(Packet &pkt)
     DataAck *p = (DataAck*)(&pkt);
     DataAck::seq_t seqno = p->ackno();
     simtime_picosec ts = p->ts();
+    uint32_t segments = p->segments();
 
     // if (p->hasCongaFeedback()) {
     //     cout << "[DEBUG TcpSrc::receivePacket] - leaf_id: "
@@ -150,6 +170,10 @@ TcpSrc::receivePacket(Packet &pkt)
     //     _myLeafSwitch->processCongestionFeedback(*p);
     // }
 
+    if (_enable_sack) {
+        updateScoreboard(*p);
+    }
+
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
     p->free();
 
@@ -164,23 +188,24 @@ TcpSrc::receivePacket(Packet &pkt)
             _flowgen->finishFlow(id);
         }
         _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
 
         // Ming added _flowsize
-        cout << setprecision(6) << "Flow " << str() << " " << id << " size " << _flowsize
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << " " << id << " size " << _flowsize
              << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
              << " fct " << timeAsUs(current_ts - _start_time)
              << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
              << " tput " << _flowsize * 8000.0 / (current_ts - _start_time)
              << " rtt " << timeAsUs(_rtt)
              << " cwnd " << _cwnd
-             << " alpha " << _alpha << endl;
+             << " alpha " << _alpha << '\n';
 
         return;
     }
 
     // Delayed / reordered ack. Shouldn't happen for simple queues.
     if (seqno < _last_acked) {
-        cout << "ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << endl;
+        OUTPUT(WARNING) << "ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << '\n';
         return;
     }
 
@@ -210,12 +235,16 @@ TcpSrc::receivePacket(Packet &pkt)
         if (_rto < timeFromUs(MIN_RTO_US)) {
             _rto = timeFromUs(MIN_RTO_US);
         }
+        if (_enable_pfabric) {
+            _rto = timeFromUs(PFABRIC_RTO_US);
+        }
     }
 
     if (_enable_dctcp) {
         // Update ECN counters.
+        // A delayed ack speaks for every segment it covers.
         if (pkt.getFlag(Packet::ECN_REV)) {
-            _marked_pkts += 1;
+            _marked_pkts += segments;
 
             // If in slow_start, exit and update _sshthresh.
             if (_state == SLOW_START && _ssthresh > _cwnd) {
@@ -223,7 +252,7 @@ TcpSrc::receivePacket(Packet &pkt)
                 _ssthresh = _cwnd;
             }
         }
-        _total_pkts += 1;
+        _total_pkts += segments;
 
         // Update _alpha and _cwnd, roughly once per cwnd of data.
         if (_total_pkts * MSS_BYTES > _dctcp_cwnd) {
@@ -248,6 +277,11 @@ TcpSrc::receivePacket(Packet &pkt)
         }
     }
 
+    if (_enable_sack) {
+        processSackAck(seqno);
+        return;
+    }
+
     // Brand new ack.
     if (seqno > _last_acked) {
 
@@ -315,6 +349,11 @@ TcpSrc::receivePacket(Packet &pkt)
         return;
     }
 
+    // pFabric leaves losses to the timeout.
+    if (_enable_pfabric) {
+        return;
+    }
+
     // Not yet in fast recovery. Wait for more dupacks.
     _dupacks++;
 
@@ -387,52 +426,82 @@ TcpSrc::sendPackets()
     }
 
     while (_last_acked + _cwnd >= _highest_sent + MSS_BYTES) {
-        DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, _highest_sent + 1, MSS_BYTES);
-
-        p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
-        p->set_ts(current_ts);
-
-        // pFabric priority.
-        //if (ENABLE_PFABRIC) {
-        //    p->setPriority(_flowsize);
-        //}
-
-        if (_enable_deadline) {
-            // Calculate and set deadline for this packet.
-            simtime_picosec timeRemaining;
-            //if (_deadline - timeFromUs(8) > current_ts) {
-            if (_deadline > current_ts) {
-                timeRemaining = _deadline - current_ts;
-            } else {
-                timeRemaining = 0;
+        if (_enable_pacing && _rtt != 0) {
+            if (current_ts < _pace_next) {
+                if (!_pace_pending) {
+                    Pacer::Get().schedule(*this, _pace_next);
+                }
+                break;
             }
 
-            uint64_t packetsRemaining = (_flowsize - _highest_sent) / MSS_BYTES + 1;
-            uint64_t slack = (timeRemaining / packetsRemaining);
-            uint64_t hist = slack/1000000;
+            // Linux-style gains: twice the window rate in slow start.
+            double gain = (_state == SLOW_START) ? 2.0 : 1.2;
+            simtime_picosec interval = llround(_rtt * (double)MSS_BYTES / (gain * _cwnd));
+            _pace_next = Pacer::Get().nextSendTime(_pace_next, interval);
+        }
 
-            if (slacks.find(hist) == slacks.end()) {
-                slacks[hist] = 1;
-            } else {
-                slacks[hist] += 1;
-            }
-            totalPkts += 1;
+        sendNewSegment();
 
-            p->setFlag(Packet::DEADLINE);
-            p->setPriority(llround(timeAsNs(slack)));
+        if (_flowsize > 0 && _highest_sent >= _flowsize) {
+            break;
         }
+    }
+}
+
+void
+TcpSrc::pacedSend()
+{
+    if (_state != FINISH) {
+        sendPackets();
+    }
+}
+
+void
+TcpSrc::sendNewSegment()
+{
+    simtime_picosec current_ts = EventList::Get().now();
 
-        _highest_sent += MSS_BYTES;
-        _packets_sent += MSS_BYTES;
-        p->sendOn();
+    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, _highest_sent + 1, MSS_BYTES);
 
-        if (_RFC2988_RTO_timeout == 0) { // RFC2988 5.1
-            _RFC2988_RTO_timeout = current_ts + _rto;
+    p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
+    p->set_ts(current_ts);
+
+    // pFabric priority.
+    if (_enable_pfabric) {
+        p->setPriority(pfabricPriority());
+    }
+
+    if (_enable_deadline) {
+        // Calculate and set deadline for this packet.
+        simtime_picosec timeRemaining;
+        //if (_deadline - timeFromUs(8) > current_ts) {
+        if (_deadline > current_ts) {
+            timeRemaining = _deadline - current_ts;
+        } else {
+            timeRemaining = 0;
         }
 
-        if (_flowsize > 0 && _highest_sent >= _flowsize) {
-            break;
+        uint64_t packetsRemaining = (_flowsize - _highest_sent) / MSS_BYTES + 1;
+        uint64_t slack = (timeRemaining / packetsRemaining);
+        uint64_t hist = slack/1000000;
+
+        if (slacks.find(hist) == slacks.end()) {
+            slacks[hist] = 1;
+        } else {
+            slacks[hist] += 1;
         }
+        totalPkts += 1;
+
+        p->setFlag(Packet::DEADLINE);
+        p->setPriority(llround(timeAsNs(slack)));
+    }
+
+    _highest_sent += MSS_BYTES;
+    _packets_sent += MSS_BYTES;
+    p->sendOn();
+
+    if (_RFC2988_RTO_timeout == 0) { // RFC2988 5.1
+        _RFC2988_RTO_timeout = current_ts + _rto;
     }
 }
 
@@ -443,14 +512,20 @@ TcpSrc::retransmitPacket(int reason)
         cout << str() << " RETX " << EventList::Get().now() << " " << reason << endl;
     }
 
-    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, _last_acked + 1, MSS_BYTES);
+    retransmitSegment(_last_acked);
+}
+
+void
+TcpSrc::retransmitSegment(uint64_t seqno)
+{
+    DataPacket *p = DataPacket::newpkt(_flow, *_route_fwd, seqno + 1, MSS_BYTES);
     p->flow().logTraffic(*p, *this, TrafficLogger::PKT_CREATESEND);
     p->set_ts(EventList::Get().now());
 
     // pFabric priority.
-    //if (ENABLE_PFABRIC) {
-    //    p->setPriority(_flowsize);
-    //}
+    if (_enable_pfabric) {
+        p->setPriority(pfabricPriority());
+    }
 
     if (_enable_deadline) {
         p->setFlag(Packet::DEADLINE);
@@ -465,20 +540,222 @@ TcpSrc::retransmitPacket(int reason)
     }
 }
 
+uint32_t
+TcpSrc::pfabricPriority()
+{
+    // Remaining flow size; flows of unknown size go last.
+    if (_flowsize == 0) {
+        return UINT32_MAX;
+    }
+    return (uint32_t)min(_flowsize - _last_acked, (uint64_t)UINT32_MAX);
+}
+
+void
+TcpSrc::updateScoreboard(DataAck &ack)
+{
+    // Blocks are [start, end) in sequence numbers, which count from 1.
+    for (uint32_t i = 0; i < ack.nSack(); i++) {
+        uint64_t start = ack.sack(i).first - 1;
+        uint64_t end = ack.sack(i).second - 1;
+
+        start = max(start, (uint64_t)ack.ackno());
+        end = min(end, _highest_sent);
+        if (end <= start) {
+            continue;
+        }
+
+        auto it = _sacked.upper_bound(start);
+        if (it != _sacked.begin() && prev(it)->second >= start) {
+            it = prev(it);
+            start = it->first;
+        }
+        while (it != _sacked.end() && it->first <= end) {
+            end = max(end, it->second);
+            it = _sacked.erase(it);
+        }
+        _sacked[start] = end;
+    }
+}
+
+void
+TcpSrc::processSackAck(DataAck::seq_t seqno)
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    // Brand new ack.
+    if (seqno > _last_acked) {
+        // RFC 2988 5.3, 5.2
+        _RFC2988_RTO_timeout = current_ts + _rto;
+        if (seqno == _highest_sent) {
+            _RFC2988_RTO_timeout = 0;
+        }
+
+        _last_acked = seqno;
+        _dupacks = 0;
+
+        // Forget sacked ranges the cumulative ack has covered.
+        while (!_sacked.empty() && _sacked.begin()->first < _last_acked) {
+            auto it = _sacked.begin();
+            if (it->second > _last_acked) {
+                _sacked[_last_acked] = it->second;
+            }
+            _sacked.erase(it);
+        }
+
+        if (_state != FAST_RECOV) {
+            inflateWindow();
+            if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV);
+            sendPackets();
+            return;
+        }
+
+        if (seqno >= _recover_seq) {
+            // Whole recovery window acked: resume normal service.
+            uint32_t flightsize = _highest_sent - seqno;
+            _cwnd = min(_ssthresh, flightsize + MSS_BYTES);
+            _state = CONG_AVOID;
+
+            if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_FR_END);
+            sendPackets();
+            return;
+        }
+
+        // Partial ack: the scoreboard tells us what else is missing.
+        if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_FR);
+        sackRecovery();
+        return;
+    }
+
+    // It's a dup ack.
+    if (_state == FAST_RECOV) {
+        if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_DUP_FR);
+        sackRecovery();
+        return;
+    }
+
+    // pFabric leaves losses to the timeout, sacked or not.
+    if (_enable_pfabric) {
+        return;
+    }
+
+    // Enter recovery on three dupacks, or once three segments are sacked.
+    _dupacks++;
+    uint64_t sacked = 0;
+    for (auto &r : _sacked) {
+        sacked += r.second - r.first;
+    }
+
+    if (_dupacks < 3 && sacked < 3 * MSS_BYTES) {
+        if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_DUP);
+        sendPackets();
+        return;
+    }
+
+    if (_last_acked < _recover_seq) {
+        // See RFC 3782: if we haven't recovered from timeouts etc. don't do fast recovery.
+        if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_3DUPNOFR);
+        return;
+    }
+
+    _drops++;
+
+    _ssthresh = max(_cwnd / 2, (uint32_t)(MSS_BYTES * 2));
+    _cwnd = _ssthresh;
+    _state = FAST_RECOV;
+    _recover_seq = _highest_sent;
+    _high_rxt = _last_acked;
+
+    if (_logger) _logger->logTcp(*this, TcpLogger::TCP_RCV_DUP_FASTXMIT);
+    sackRecovery();
+}
+
+uint64_t
+TcpSrc::nextHole()
+{
+    // Everything below the highest sacked byte that is neither sacked nor
+    // already retransmitted is considered lost.
+    uint64_t seq = max(_high_rxt, _last_acked);
+
+    for (auto &r : _sacked) {
+        if (seq < r.first) {
+            return seq;
+        }
+        seq = max(seq, r.second);
+    }
+    return ULLONG_MAX;
+}
+
+uint64_t
+TcpSrc::pipe()
+{
+    uint64_t outstanding = _highest_sent - _last_acked;
+    uint64_t seq = max(_high_rxt, _last_acked);
+    uint64_t sacked = 0, lost = 0;
+
+    for (auto &r : _sacked) {
+        sacked += r.second - r.first;
+        if (seq < r.first) {
+            lost += r.first - seq;
+        }
+        seq = max(seq, r.second);
+    }
+
+    return (sacked + lost < outstanding) ? outstanding - sacked - lost : 0;
+}
+
+void
+TcpSrc::sackRecovery()
+{
+    uint64_t inflight = pipe();
+
+    while (_cwnd >= inflight + MSS_BYTES) {
+        uint64_t hole = nextHole();
+
+        if (hole != ULLONG_MAX) {
+            retransmitSegment(hole);
+            _high_rxt = hole + MSS_BYTES;
+        } else if (_flowsize == 0 || _highest_sent < _flowsize) {
+            sendNewSegment();
+        } else {
+            break;
+        }
+        inflight += MSS_BYTES;
+    }
+}
 
-TcpSink::TcpSink() : DataSink() {}
+
+TcpSink::TcpSink()
+    : DataSink(),
+    _pending(0),
+    _pending_since(0),
+    _pending_ts(0),
+    _ce_state(false),
+    _last_seqno(0),
+    _timer(*this),
+    _timer_pending(false)
+{}
 
 void
 TcpSink::receivePacket(Packet &pkt)
 {
     DataPacket *p = (DataPacket*)(&pkt);
     simtime_picosec ts = p->ts();
+    DataPacket::seq_t seqno = p->seqno();
+    bool ce = p->getFlag(Packet::ECN_FWD);
 
     // cout << "[DEBUG-SINK] Received data packet at sink, "
     //      << "flow_id: " << p->flow().id
     //      << " node_id: " << _node_id
     //      << endl;
 
+    // DCTCP: ack what we hold with the old ECN state before it changes.
+    if (_pending > 0 && ce != _ce_state) {
+        sendAck();
+    }
+
+    // Only in-order data that leaves nothing held may be delayed.
+    bool inOrder = (seqno == _cumulative_ack + 1) && _received.empty();
+
     processDataPacket(*p);
 
     if (p->getFlag(Packet::DEADLINE)) {
@@ -492,24 +769,89 @@ TcpSink::receivePacket(Packet &pkt)
         totalPkts += 1;
     }
 
+    if (_pending == 0) {
+        _pending_since = EventList::Get().now();
+        _pending_ts = ts;
+    }
+    _pending++;
+    _ce_state = ce;
+    _last_seqno = seqno;
+    _conga_info = p->conga_info;
+
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_RCVDESTROY);
     p->free();
 
+    if (!inOrder || _pending >= _delack_segments ||
+            (_src->_flowsize > 0 && _cumulative_ack >= _src->_flowsize)) {
+        sendAck();
+    } else if (!_timer_pending) {
+        _timer_pending = true;
+        EventList::Get().sourceIsPendingRel(_timer, _delack_timeout);
+    }
+}
+
+void
+TcpSink::delackTimeout()
+{
+    _timer_pending = false;
+    if (_pending == 0) {
+        return;
+    }
+
+    // The timer may have been armed for an earlier, already acked batch.
+    simtime_picosec due = _pending_since + _delack_timeout;
+    if (EventList::Get().now() >= due) {
+        sendAck();
+    } else {
+        _timer_pending = true;
+        EventList::Get().sourceIsPending(_timer, due);
+    }
+}
+
+void
+TcpSink::sendAck()
+{
     DataAck *ack = DataAck::newpkt(_src->_flow, *_route, 1, _cumulative_ack);
 
     ack->setFlag(Packet::ACK);
-    ack->conga_info = p->conga_info;
+    ack->conga_info = _conga_info;
+    ack->setSegments(_pending);
 
     // cout << "[DEBUG-SINK] Generated ACK at sink, "
     //          << "flow_id: " << ack->flow().id
     //          << " route size: " << _route->size()
     //          << endl;
 
+    if (TcpSrc::_enable_sack && !_received.empty()) {
+        addSackBlocks(*ack, _last_seqno);
+    }
+
     ack->flow().logTraffic(*ack, *this, TrafficLogger::PKT_CREATESEND);
-    ack->set_ts(ts);
-    if (p->getFlag(Packet::ECN_FWD)) {
+    ack->set_ts(_pending_ts);
+    if (_ce_state) {
         ack->setFlag(Packet::ECN_REV);
     }
+    _pending = 0;
     ack->sendOn();
 }
 
+void
+TcpSink::addSackBlocks(DataAck &ack,
+                       DataPacket::seq_t seqno)
+{
+    // RFC 2018: the first block reports the most recently received
+    // segment, the rest follow in ascending order. Only as many blocks as
+    // fit are looked at, so an ack costs the same however much is held.
+    DataAck::seq_t start = 0, end = 0;
+    bool first = _received.rangeAround(seqno, start, end);
+    if (first) {
+        ack.addSack(start, end);
+    }
+
+    _received.ranges(_sackRanges, MAX_SACK_BLOCKS);
+    for (uint32_t i = 0; i < _sackRanges.size() && ack.nSack() < MAX_SACK_BLOCKS; i++) {
+        if (!first || _sackRanges[i].first != start) {
+            ack.addSack(_sackRanges[i].first, _sackRanges[i].second);
+        }
+    }
+}
@@ -6,14 +6,18 @@
 
 #include "eventlist.h"
 #include "datasource.h"
+#include "pacer.h"
 // #include "testbed/switch/leafswitch.h"
 
 #define DCTCP_GAIN 0.0625
 
+#define PFABRIC_INIT_CWND 12   // Packets, about a BDP: flows start at line rate.
+#define PFABRIC_RTO_US    45   // Fixed RTO, about 3 RTTs.
+
 class TcpSink;
 class FlowGenerator;
 
-class TcpSrc : public DataSource
+class TcpSrc : public DataSource, public PacedSource
 {
     friend class TcpSink;
     public:
@@ -23,6 +27,7 @@ class TcpSrc : public DataSource
     void printStatus();
     void doNextEvent();
     void receivePacket(Packet &pkt);
+    void pacedSend();
 
     // Flow status.
     enum FlowStatus {
@@ -54,6 +59,27 @@ class TcpSrc : public DataSource
     // DCTCP enable flag.
     static bool _enable_dctcp;
 
+    // pFabric enable flag. Packets carry the flow's remaining size as
+    // their priority, for priority queues to serve the smallest first and
+    // drop the largest. Rate control is minimal: start with a BDP window,
+    // no fast retransmit, and a small fixed RTO after which the flow
+    // slow-starts from one packet.
+    static bool _enable_pfabric;
+
+    // SACK enable flag (sinks report SACK blocks, sources recover from them).
+    static bool _enable_sack;
+
+    // SACK scoreboard: sacked byte ranges [start, end) above _last_acked,
+    // in the same (bytes acked) units as _last_acked and _highest_sent.
+    std::map<uint64_t, uint64_t> _sacked;
+    uint64_t _high_rxt; // End of the highest hole retransmitted in recovery.
+
+    // Pacing enable flag. Once there is an RTT estimate, new segments are
+    // spread out at gain * cwnd / srtt by the shared Pacer instead of
+    // leaving in a window-sized burst. Retransmissions are not paced.
+    static bool _enable_pacing;
+    simtime_picosec _pace_next; // Earliest time of the next new segment.
+
     static std::map<uint64_t, uint64_t> slacks;
     static uint64_t totalPkts;
     //
@@ -63,7 +89,17 @@ class TcpSrc : public DataSource
     // Mechanism
     void inflateWindow();
     void sendPackets();
+    void sendNewSegment();
     void retransmitPacket(int reason);
+    void retransmitSegment(uint64_t seqno);
+    uint32_t pfabricPriority();
+
+    // SACK-based loss recovery (RFC 6675, simplified).
+    void updateScoreboard(DataAck &ack);
+    void processSackAck(DataAck::seq_t seqno);
+    void sackRecovery();
+    uint64_t nextHole();
+    uint64_t pipe();
 
     // Housekeeping
     TcpLogger *_logger;
@@ -82,6 +118,44 @@ class TcpSink : public DataSink
 
     static std::map<uint64_t, uint64_t> slacks;
     static uint64_t totalPkts;
+
+    // Delayed acks: ack every _delack_segments in-order segments, or after
+    // _delack_timeout. Out-of-order data, hole fills, a change of ECN state
+    // (as DCTCP requires) and the end of the flow are acked immediately.
+    // A value of 1 acks every segment, as before.
+    static uint32_t _delack_segments;
+    static simtime_picosec _delack_timeout;
+
+    private:
+    // Fires the delayed ack timer; the eventlist can't cancel events, so
+    // a stale timer just finds nothing to do.
+    class DelayedAckTimer : public EventSource
+    {
+        public:
+        DelayedAckTimer(TcpSink &sink) : EventSource("delack"), _sink(sink) {}
+        void doNextEvent() { _sink.delackTimeout(); }
+        private:
+        TcpSink &_sink;
+    };
+
+    // Ack everything received so far.
+    void sendAck();
+    void delackTimeout();
+
+    // Report held out-of-order data, the block holding seqno first.
+    void addSackBlocks(DataAck &ack, DataPacket::seq_t seqno);
+
+    // Segments received but not yet acked, and their ack state.
+    uint32_t _pending;
+    simtime_picosec _pending_since;
+    simtime_picosec _pending_ts;    // Timestamp echoed (earliest unacked).
+    bool _ce_state;                 // ECN mark of the pending segments.
+    DataPacket::seq_t _last_seqno;  // Most recently received segment.
+    std::vector<std::pair<DataPacket::seq_t,DataPacket::seq_t> > _sackRanges;
+    Packet::CongaInfo _conga_info;
+
+    DelayedAckTimer _timer;
+    bool _timer_pending;
 };
 
 #endif /* TCP_H_ */
@@ -16,6 +16,9 @@ typedef std::unordered_map<std::string,std::string> ArgList;
 void single_link_simulation(const ArgList &, Logfile &);
 void conga_testbed(const ArgList &, Logfile &);
 void fat_tree_testbed(const ArgList &, Logfile &);
+void pfabric_testbed(const ArgList &, Logfile &);
+void incast_testbed(const ArgList &, Logfile &);
+void rpc_testbed(const ArgList &, Logfile &);
 
 inline int 
 run_experiment(uint32_t expt,
@@ -38,6 +41,21 @@ run_experiment(uint32_t expt,
             fat_tree_testbed(args, logfile);
             break;
 
+        case 4:
+            // pFabric on the CONGA leaf-spine, for comparison with expt 2.
+            pfabric_testbed(args, logfile);
+            break;
+
+        case 5:
+            // Partition-aggregate incast on the CONGA leaf-spine.
+            incast_testbed(args, logfile);
+            break;
+
+        case 6:
+            // Closed-loop RPCs on the same leaf-spine.
+            rpc_testbed(args, logfile);
+            break;
+
         default:
             return -1;
     }
@@ -50,6 +68,9 @@ print_experiment_list()
     std::cerr << "  1" << " single_link_simulation" << std::endl;
     std::cerr << "  2" << " conga_testbed" << std::endl;
     std::cerr << "  3" << " fat_tree_testbed" << std::endl;
+    std::cerr << "  4" << " pfabric_testbed" << std::endl;
+    std::cerr << "  5" << " incast_testbed" << std::endl;
+    std::cerr << "  6" << " rpc_testbed" << std::endl;
 }
 
 /* Helper functions for parsing arguments. */
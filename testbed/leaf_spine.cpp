@@ -0,0 +1,144 @@
+/*
+ * Leaf-spine fabric
+ */
+#include "leaf_spine.h"
+#include "loggers.h"
+#include "pipe.h"
+#include "rng.h"
+#include "switch/constants.h"
+
+using namespace std;
+using namespace conga;
+
+namespace leafspine {
+    Pipe  *pCoreLeaf[N_CORE][N_LEAF];
+    Queue *qCoreLeaf[N_CORE][N_LEAF];
+
+    Pipe  *pLeafCore[N_CORE][N_LEAF];
+    Queue *qLeafCore[N_CORE][N_LEAF];
+
+    Pipe  *pLeafServer[N_LEAF][N_SERVER];
+    Queue *qLeafServer[N_LEAF][N_SERVER];
+
+    Pipe  *pServerLeaf[N_LEAF][N_SERVER];
+    Queue *qServerLeaf[N_LEAF][N_SERVER];
+
+    Rng *routeRng = NULL;
+
+    void createLink(Queue *&queue, Pipe *&pipe, queue_factory_t makeQueue,
+                    linkspeed_bps speed, mem_b buffer, Logfile &lf, const string &name);
+}
+
+void
+leafspine::build(const string &name,
+                 queue_factory_t makeQueue,
+                 mem_b buffer,
+                 Logfile &logfile)
+{
+    routeRng = &Rng::shared(name + "/routes");
+
+    // Core to leaf switches and vice-versa.
+    for (int i = 0; i < N_CORE; i++) {
+        for (int j = 0; j < N_LEAF; j++) {
+            string ij = to_string(i) + "-" + to_string(j);
+            createLink(qCoreLeaf[i][j], pCoreLeaf[i][j], makeQueue, CORE_SPEED, buffer,
+                       logfile, "core-leaf-" + ij);
+            createLink(qLeafCore[i][j], pLeafCore[i][j], makeQueue, CORE_SPEED, buffer,
+                       logfile, "leaf-core-" + ij);
+        }
+    }
+
+    // Leaf to servers and vice-versa.
+    for (int i = 0; i < N_LEAF; i++) {
+        for (int j = 0; j < N_SERVER; j++) {
+            string ij = to_string(i) + "-" + to_string(j);
+            createLink(qLeafServer[i][j], pLeafServer[i][j], makeQueue, LEAF_SPEED, buffer,
+                       logfile, "leaf-server-" + ij);
+            createLink(qServerLeaf[i][j], pServerLeaf[i][j], makeQueue, LEAF_SPEED, ENDH_BUFFER,
+                       logfile, "server-leaf-" + ij);
+        }
+    }
+}
+
+void
+leafspine::createLink(Queue *&queue,
+                      Pipe *&pipe,
+                      queue_factory_t makeQueue,
+                      linkspeed_bps speed,
+                      mem_b buffer,
+                      Logfile &logfile,
+                      const string &name)
+{
+    static MultiQueueLoggerSampling *queueSampler = NULL;
+    if (queueSampler == NULL) {
+        queueSampler = new MultiQueueLoggerSampling(timeFromMs(10));
+        logfile.addLogger(*queueSampler);
+    }
+
+    queue = makeQueue(speed, buffer, queueSampler->addQueue());
+    queue->setName("q-" + name);
+    logfile.writeName(*queue);
+
+    pipe = new Pipe(timeFromUs(LINK_DELAY));
+    pipe->setName("p-" + name);
+    logfile.writeName(*pipe);
+}
+
+void
+leafspine::generateRoute(route_t *&fwd,
+                         route_t *&rev,
+                         uint32_t &src,
+                         uint32_t &dst)
+{
+    const uint32_t N_NODES = N_LEAF * N_SERVER;
+
+    if (src != NODE_ANY) {
+        src = src % N_NODES;
+    } else {
+        src = routeRng->below(N_NODES);
+    }
+
+    if (dst != NODE_ANY) {
+        dst = dst % N_NODES;
+    } else {
+        dst = routeRng->below(N_NODES - 1);
+        if (dst >= src) {
+            dst++;
+        }
+    }
+
+    uint32_t src_leaf = src / N_SERVER;
+    uint32_t dst_leaf = dst / N_SERVER;
+    uint32_t src_svr  = src % N_SERVER;
+    uint32_t dst_svr  = dst % N_SERVER;
+
+    // The same flow hash as the CONGA testbed's ECMP.
+    uint32_t core = (src ^ dst) % N_CORE;
+
+    fwd = new route_t();
+    rev = new route_t();
+
+    fwd->push_back(qServerLeaf[src_leaf][src_svr]);
+    fwd->push_back(pServerLeaf[src_leaf][src_svr]);
+
+    rev->push_back(qServerLeaf[dst_leaf][dst_svr]);
+    rev->push_back(pServerLeaf[dst_leaf][dst_svr]);
+
+    if (src_leaf != dst_leaf) {
+        fwd->push_back(qLeafCore[core][src_leaf]);
+        fwd->push_back(pLeafCore[core][src_leaf]);
+        fwd->push_back(qCoreLeaf[core][dst_leaf]);
+        fwd->push_back(pCoreLeaf[core][dst_leaf]);
+
+        rev->push_back(qLeafCore[core][dst_leaf]);
+        rev->push_back(pLeafCore[core][dst_leaf]);
+        rev->push_back(qCoreLeaf[core][src_leaf]);
+        rev->push_back(pCoreLeaf[core][src_leaf]);
+    }
+
+    fwd->push_back(qLeafServer[dst_leaf][dst_svr]);
+    fwd->push_back(pLeafServer[dst_leaf][dst_svr]);
+
+    rev->push_back(qLeafServer[src_leaf][src_svr]);
+    rev->push_back(pLeafServer[src_leaf][src_svr]);
+}
@@ -0,0 +1,30 @@
+/*
+ * Leaf-spine fabric header
+ */
+#ifndef LEAF_SPINE_H
+#define LEAF_SPINE_H
+
+#include "logfile.h"
+#include "network.h"
+#include "queue.h"
+
+#include <string>
+
+/*
+ * The CONGA testbed's leaf-spine (switch/constants.h) without its switch
+ * logic: every port is a queue from the caller's factory and flows are
+ * hashed onto a core as with ECMP. Experiments that differ only in the
+ * port discipline (pFabric, incast, RPC) build it and route over it.
+ */
+namespace leafspine {
+    // Makes a port of the given speed and buffer.
+    typedef Queue *(*queue_factory_t)(linkspeed_bps speed, mem_b buffer, QueueLogger *logger);
+
+    // Switch ports get buffer bytes, host NICs ENDH_BUFFER. Random route
+    // ends are drawn from the stream name + "/routes".
+    void build(const std::string &name, queue_factory_t makeQueue, mem_b buffer, Logfile &lf);
+
+    void generateRoute(route_t *&fwd, route_t *&rev, uint32_t &src, uint32_t &dst);
+}
+
+#endif /* LEAF_SPINE_H */
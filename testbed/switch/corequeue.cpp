@@ -1,17 +1,18 @@
 #include "corequeue.h"
+#include "output.h"
 
 
 using namespace conga;
 
 void CoreQueue::receivePacket(Packet &pkt) {
     // First handle the packet queuing
-    if (_queuesize + pkt.size() > _maxsize) {
-        std::cout << "[DEBUG-QUEUE] Queue " << str()
+    if (overflow(pkt)) {
+        OUTPUT(DROP) << "[DEBUG-QUEUE] Queue " << str()
              << " dropped packet due to overflow"
              << " current size: " << _queuesize
              << " packet size: " << pkt.size()
              << " max size: " << _maxsize
-             << std::endl;
+             << '\n';
 
         if (_logger) {
             _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
@@ -23,14 +24,9 @@ void CoreQueue::receivePacket(Packet &pkt) {
 
     // Edit packet
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
-    bool queueWasEmpty = _enqueued.empty();
-    _enqueued.push_front(&pkt);
-    _queuesize += pkt.size();
-
-    // Edit packet
-    if (pkt.getFlags() < 16) {
-        updateCongestion(pkt);
-    }
+    bool queueWasEmpty = idle();
+    push(pkt);
+    onArrival(pkt, occupancy(EventList::Get().now()));
 
     // continue normal operation
     if (_logger) {
@@ -38,12 +34,18 @@ void CoreQueue::receivePacket(Packet &pkt) {
     }
 
     if (queueWasEmpty) {
-        assert(_enqueued.size() == 1);
         beginService();
     }
 }
 
-void CoreQueue::updateCongestion(Packet& pkt) {
+void CoreQueue::onArrival(Packet& pkt, mem_b occupancy) {
+    // Edit packet
+    if (!pkt.getFlag(Packet::ACK)) {
+        updateCongestion(pkt, occupancy);
+    }
+}
+
+void CoreQueue::updateCongestion(Packet& pkt, mem_b occupancy) {
     auto congaInfo = pkt.getCongaInfo();
 
     // 检查是否是源叶子交换机
@@ -59,7 +61,7 @@ void CoreQueue::updateCongestion(Packet& pkt) {
     // }
 
     // Calculate queue utilization using available queue info
-    double queueUtilization = (this->_queuesize * 1.0) / this->_maxsize;
+    double queueUtilization = (occupancy * 1.0) / this->_maxsize;
     // std::cout << "core" << core_id << " queuesize" << this->_queuesize << std::endl;
 
     dre_map[congaInfo.src_leaf_id] = queueUtilization;
@@ -21,11 +21,14 @@ namespace conga {
         CoreQueue(linkspeed_bps bitrate, mem_b maxsize, QueueLogger* logger)
             : Queue(bitrate, maxsize, logger), leaf_id(0) {}
 
-        void updateCongestion(Packet& pkt);
+        void updateCongestion(Packet& pkt, mem_b occupancy);
 
         // override receivePacket
         void receivePacket(Packet& pkt) override;
 
+        // CONGA state is updated from the queue length on every arrival.
+        void onArrival(Packet& pkt, mem_b occupancy) override;
+
         void setCoreId(uint32_t id) { core_id = id; }
         void setLeafId(uint32_t id) { leaf_id = id; }
         void setDstLeafId(uint32_t id) { dst_leaf_id = id; }
@@ -1,11 +1,12 @@
 #ifndef CONGA_ECMP_SWITCH_H
 #define CONGA_ECMP_SWITCH_H
 
-#include <random>
 #include "../eventlist.h"
 #include "../logfile.h"
 #include "../queue.h"
 #include "../pipe.h"
+#include "../output.h"
+#include "../rng.h"
 #include "tcp_flow.h"
 #include "constants.h"
 #include "corequeue.h"
@@ -25,17 +26,12 @@ namespace conga {
 
     class ECMPSwitch {
     private:
-        std::random_device rd;
-        std::mt19937 gen;
-
         uint32_t flowHash(const TCPFlow& flow) const {
             std::hash<TCPFlow> hasher;
             return static_cast<uint32_t>(hasher(flow));
         }
 
     public:
-        ECMPSwitch() : gen(rd()) {}
-
         uint32_t selectCorePath(const TCPFlow& flow) {
             // uint32_t hash = flowHash(flow);
             return (flow.src_ip ^ flow.dst_ip) % N_CORE;
@@ -47,11 +43,18 @@ namespace conga {
             uint32_t src = flow.src_ip;
             uint32_t dst = flow.dst_ip;
             // Generate random source and destination if not specified
-            // use the gen object to generate random numbers
-
-            if (src == 0) src = rand() % TOTAL_SERVERS;
-            if (dst == 0) dst = rand() % (TOTAL_SERVERS - 1);
-            if (dst >= src) dst++;
+            Rng &rng = Rng::shared("ecmp/routes");
+            if (src == NODE_ANY) {
+                src = rng.below(TOTAL_SERVERS);
+            } else {
+                src = src % TOTAL_SERVERS;
+            }
+            if (dst == NODE_ANY) {
+                dst = rng.below(TOTAL_SERVERS - 1);
+                if (dst >= src) dst++;
+            } else {
+                dst = dst % TOTAL_SERVERS;
+            }
             flow.src_ip = src;
             flow.dst_ip = dst;
 
@@ -62,7 +65,7 @@ namespace conga {
             uint32_t dst_server = dst % N_SERVER;
 
             uint32_t core_switch = selectCorePath(flow);
-            std::cout<<"ecmp chose core switch "<<core_switch<<std::endl;
+            OUTPUT(ROUTE) << "ecmp chose core switch " << core_switch << '\n';
 
             //printf("select core switch %d\n", core_switch);
             fwd = new route_t();
@@ -5,19 +5,20 @@
 #include "eventlist.h"
 #include <priorityqueue.h>
 #include "loggers.h"
+#include "output.h"
 
 using namespace conga;
 
 // Override receivePacket as per the header file
 void LeafSwitch::receivePacket(Packet& pkt) {
     // First handle the packet queuing
-    if (_queuesize + pkt.size() > _maxsize) {
-        std::cout << "[DEBUG-QUEUE] Queue " << str()
+    if (overflow(pkt)) {
+        OUTPUT(DROP) << "[DEBUG-QUEUE] Queue " << str()
              << " dropped packet due to overflow"
              << " current size: " << _queuesize
              << " packet size: " << pkt.size()
              << " max size: " << _maxsize
-             << std::endl;
+             << '\n';
 
         if (_logger) {
             _logger->logQueue(*this, QueueLogger::PKT_DROP, pkt);
@@ -29,18 +30,9 @@ void LeafSwitch::receivePacket(Packet& pkt) {
 
     // Edit packet
     pkt.flow().logTraffic(pkt, *this, TrafficLogger::PKT_ARRIVE);
-    bool queueWasEmpty = _enqueued.empty();
-    _enqueued.push_front(&pkt);
-    _queuesize += pkt.size();
-
-    if (pkt.getFlags() >= 16) {
-        // for ack packet, add remote congestion
-        processAck(pkt);
-
-    } else {
-        // for send packet, update packet info
-        processDataPacket(pkt);
-    }
+    bool queueWasEmpty = idle();
+    push(pkt);
+    onArrival(pkt, occupancy(EventList::Get().now()));
 
     // continue normal operation
     if (_logger) {
@@ -48,13 +40,23 @@ void LeafSwitch::receivePacket(Packet& pkt) {
     }
 
     if (queueWasEmpty) {
-        assert(_enqueued.size() == 1);
         beginService();
     }
 }
 
+void LeafSwitch::onArrival(Packet& pkt, mem_b occupancy) {
+    if (pkt.getFlag(Packet::ACK)) {
+        // for ack packet, add remote congestion
+        processAck(pkt);
+
+    } else {
+        // for send packet, update packet info
+        processDataPacket(pkt, occupancy);
+    }
+}
+
 // Process Data Packet
-void LeafSwitch::processDataPacket(Packet& pkt) {
+void LeafSwitch::processDataPacket(Packet& pkt, mem_b occupancy) {
     auto congaInfo = pkt.getCongaInfo();
 
     // 检查是否是源叶子交换机
@@ -64,7 +66,7 @@ void LeafSwitch::processDataPacket(Packet& pkt) {
             this->leaf_id,
             this->core_id,
             this->dst_leaf_id,
-            this->measureLocalCongestion(core_id));
+            this->measureLocalCongestion(core_id, occupancy));
     }
     // 检查是否是目的叶子交换机
     else if (congaInfo.has_congestion_info && this->leaf_id == congaInfo.dst_leaf_id) {
@@ -145,8 +147,8 @@ LeafSwitch::CongestionInfo LeafSwitch::selectFeedbackMetric(uint32_t src_leaf) {
 }
 
 // Measure local congestion based on core switch ID
-double LeafSwitch::measureLocalCongestion(uint32_t core_id) {
-    double localDRE = calculateDRE(core_id);
+double LeafSwitch::measureLocalCongestion(uint32_t core_id, mem_b occupancy) {
+    double localDRE = calculateDRE(core_id, occupancy);
     double remoteCongestion = getPathCongestion(core_id);
 
     double pathCongestion = std::max(localDRE, remoteCongestion);
@@ -154,7 +156,7 @@ double LeafSwitch::measureLocalCongestion(uint32_t core_id) {
     return pathCongestion;
 }
 
-double LeafSwitch::calculateDRE(uint32_t core_id) {
+double LeafSwitch::calculateDRE(uint32_t core_id, mem_b occupancy) {
 
     Queue* uplinkQueue = this;
     auto now = EventList::Get().now();
@@ -165,7 +167,7 @@ double LeafSwitch::calculateDRE(uint32_t core_id) {
     // }
 
     // Calculate queue utilization using available queue info
-    double queueUtilization = static_cast<double>(this->_queuesize) /
+    double queueUtilization = static_cast<double>(occupancy) /
                             static_cast<double>(this->_maxsize);
 
     // Calculate new DRE using EWMA
@@ -24,11 +24,15 @@ namespace conga {
 
         void setDstLeafId(uint32_t id) { dst_leaf_id = id; }
 
-        double measureLocalCongestion(uint32_t core_id);
+        // Congestion towards core_id, with occupancy bytes queued here.
+        double measureLocalCongestion(uint32_t core_id, mem_b occupancy);
 
         // override receivePacket
         void receivePacket(Packet& pkt) override;
 
+        // CONGA state is updated from the queue length on every arrival.
+        void onArrival(Packet& pkt, mem_b occupancy) override;
+
     private:
         uint32_t leaf_id;
         uint32_t core_id;
@@ -55,7 +59,7 @@ namespace conga {
         } metrics_;
         static constexpr simtime_picosec UPDATE_INTERVAL = 50000000;
 
-        double calculateDRE(uint32_t core_id);
+        double calculateDRE(uint32_t core_id, mem_b occupancy);
         double getPathCongestion(uint32_t core_id) const;
 
         // core_id, metrics
@@ -68,7 +72,7 @@ namespace conga {
         std::unordered_map<uint32_t, uint32_t> feedbackCounter;
 
         // 处理不同类型的数据包
-        void processDataPacket(Packet& pkt);
+        void processDataPacket(Packet& pkt, mem_b occupancy);
         void processAck(Packet& pkt);
 
         // 更新和选择拥塞信息
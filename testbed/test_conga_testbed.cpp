@@ -8,6 +8,7 @@
 #include "flow-generator.h"
 #include "pipe.h"
 #include "test.h"
+#include "output.h"
 #include "prof.h"
 #include<string>
 #include<functional>
@@ -15,7 +16,6 @@
 #include "switch/leafswitch.h"
 #include "switch/constants.h"
 #include "switch/corequeue.h"
-#include <random>
 #include <chrono>
 #include"switch/statistics.h"
 
@@ -34,6 +34,9 @@ namespace conga {
     Pipe *pServerLeaf[N_LEAF][N_SERVER]; // Server to Leaf pipes
     Queue *qServerLeaf[N_LEAF][N_SERVER]; // Server to Leaf queues
 
+    // Fabric-wide queue sampler.
+    MultiQueueLoggerSampling *queueSampler = NULL;
+
     // Helper functions
     ECMPSwitch ecmpSwitch;
 
@@ -43,13 +46,56 @@ namespace conga {
         std::hash<TCPFlow> hasher;
         return static_cast<uint32_t>(hasher(flow));
     }
-    static std::mt19937 rng(std::chrono::steady_clock::now().time_since_epoch().count());
-
     // Helper function to generate random numbers in a range
     inline uint32_t getRandomInRange(uint32_t min, uint32_t max) {
-        std::uniform_int_distribution<uint32_t> dist(min, max);
-        return dist(rng);
+        return min + Rng::shared("conga/routes").below(max - min + 1);
     }
+
+    // Routes between servers src and dst through the given core switch.
+    void buildRoute(route_t *&fwd, route_t *&rev, uint32_t src, uint32_t dst, uint32_t core_switch) {
+        uint32_t src_leaf = src / N_SERVER;
+        uint32_t dst_leaf = dst / N_SERVER;
+        uint32_t src_server = src % N_SERVER;
+        uint32_t dst_server = dst % N_SERVER;
+
+        // Create routes
+        fwd = new route_t();
+        rev = new route_t();
+
+        // Forward path
+        // Server to Leaf
+        fwd->push_back(qServerLeaf[src_leaf][src_server]); // This is now a LeafSwitch
+        fwd->push_back(pServerLeaf[src_leaf][src_server]);
+
+        if (src_leaf != dst_leaf) {
+            // Leaf to Core
+            fwd->push_back(qLeafCore[core_switch][src_leaf]); // This is a LeafSwitch
+            fwd->push_back(pLeafCore[core_switch][src_leaf]);
+
+            // Core to Leaf
+            fwd->push_back(qCoreLeaf[core_switch][dst_leaf]); // This remains a Queue
+            fwd->push_back(pCoreLeaf[core_switch][dst_leaf]);
+        }
+
+        // Leaf to Server
+        fwd->push_back(qLeafServer[dst_leaf][dst_server]); // This is a LeafSwitch
+        fwd->push_back(pLeafServer[dst_leaf][dst_server]);
+
+        // Reverse path (for ACKs)
+        rev->push_back(qServerLeaf[dst_leaf][dst_server]); // LeafSwitch
+        rev->push_back(pServerLeaf[dst_leaf][dst_server]);
+
+        if (src_leaf != dst_leaf) {
+            rev->push_back(qLeafCore[core_switch][dst_leaf]); // LeafSwitch
+            rev->push_back(pLeafCore[core_switch][dst_leaf]);
+            rev->push_back(qCoreLeaf[core_switch][src_leaf]); // Queue
+            rev->push_back(pCoreLeaf[core_switch][src_leaf]);
+        }
+
+        rev->push_back(qLeafServer[src_leaf][src_server]); // LeafSwitch
+        rev->push_back(pServerLeaf[src_leaf][src_server]);
+    }
+
     // Modified route generation function that uses ECMP switch
     void generateCongaRoute(route_t *&fwd, route_t *&rev, uint32_t &src, uint32_t &dst) {
         // measure the select route time
@@ -57,17 +103,17 @@ namespace conga {
         const int TOTAL_SERVERS = N_LEAF * N_SERVER;
 
         // Generate random source and destination if not specified
-        if (src == 0) {
+        if (src == NODE_ANY) {
             src = getRandomInRange(0, TOTAL_SERVERS - 1);
         } else {
             src = src % TOTAL_SERVERS;
         }
-        if (dst == 0) {
+        if (dst == NODE_ANY) {
             dst = getRandomInRange(0, TOTAL_SERVERS - 2);
+            if (dst >= src) dst++;
         } else {
-            dst = dst % (TOTAL_SERVERS - 1);
+            dst = dst % TOTAL_SERVERS;
         }
-        if (dst >= src) dst++;
 
         // Calculate source and destination leaf switches
         uint32_t src_leaf = src / N_SERVER;
@@ -95,7 +141,7 @@ namespace conga {
 
             for (int i = 0; i < N_CORE; i++) {
                 srcLeafSwitch = qLeafCore[i][src_leaf];
-                double currentCongestion = srcLeafSwitch->measureLocalCongestion(i);
+                double currentCongestion = srcLeafSwitch->measureLocalCongestion(i, srcLeafSwitch->occupancy(now));
                 if (currentCongestion < minCongestion) {
                     minCongestion = currentCongestion;
                     core_switch = i;
@@ -110,7 +156,7 @@ namespace conga {
         }
 
         //todo test
-        std::cout << "conga chose core switch " << core_switch << std::endl;
+        OUTPUT(ROUTE) << "conga chose core switch " << core_switch << '\n';
 
         if (src_leaf != dst_leaf) {
             // 源叶子到核心
@@ -137,42 +183,7 @@ namespace conga {
         //         << " for route from leaf " << src_leaf
         //         << " to leaf " << dst_leaf << std::endl;
 
-        // Create routes
-        fwd = new route_t();
-        rev = new route_t();
-
-        // Forward path
-        // Server to Leaf
-        fwd->push_back(qServerLeaf[src_leaf][src_server]); // This is now a LeafSwitch
-        fwd->push_back(pServerLeaf[src_leaf][src_server]);
-
-        if (src_leaf != dst_leaf) {
-            // Leaf to Core
-            fwd->push_back(qLeafCore[core_switch][src_leaf]); // This is a LeafSwitch
-            fwd->push_back(pLeafCore[core_switch][src_leaf]);
-
-            // Core to Leaf
-            fwd->push_back(qCoreLeaf[core_switch][dst_leaf]); // This remains a Queue
-            fwd->push_back(pCoreLeaf[core_switch][dst_leaf]);
-        }
-
-        // Leaf to Server
-        fwd->push_back(qLeafServer[dst_leaf][dst_server]); // This is a LeafSwitch
-        fwd->push_back(pLeafServer[dst_leaf][dst_server]);
-
-        // Reverse path (for ACKs)
-        rev->push_back(qServerLeaf[dst_leaf][dst_server]); // LeafSwitch
-        rev->push_back(pServerLeaf[dst_leaf][dst_server]);
-
-        if (src_leaf != dst_leaf) {
-            rev->push_back(qLeafCore[core_switch][dst_leaf]); // LeafSwitch
-            rev->push_back(pLeafCore[core_switch][dst_leaf]);
-            rev->push_back(qCoreLeaf[core_switch][src_leaf]); // Queue
-            rev->push_back(pCoreLeaf[core_switch][src_leaf]);
-        }
-
-        rev->push_back(qLeafServer[src_leaf][src_server]); // LeafSwitch
-        rev->push_back(pServerLeaf[src_leaf][src_server]);
+        buildRoute(fwd, rev, src, dst, core_switch);
 
         // measure the select route time
         auto end = EventList::Get().now();
@@ -189,9 +200,27 @@ namespace conga {
         flow.dst_ip = dst;
         // Use ECMP switch to generate routes
         ecmpSwitch.generateECMPRoute(fwd, rev, flow);
+        src = flow.src_ip;
+        dst = flow.dst_ip;
         auto end = EventList::Get().now();
         auto duration = end - now;
-        std::cout << "[DEBUG-ROUTE] Route selection took " << timeAsMs(duration) << " ms" << std::endl;
+        OUTPUT(ROUTE) << "[DEBUG-ROUTE] Route selection took " << timeAsMs(duration) << " ms" << '\n';
+    }
+
+    // MPTCP subflow k goes through the k-th core after the one the flow's
+    // own route (ECMP hash or CONGA choice) went through.
+    void generateECMPSubflowRoute(route_t *&fwd, route_t *&rev, uint32_t src, uint32_t dst, uint32_t subflow) {
+        TCPFlow flow;
+        flow.src_ip = src;
+        flow.dst_ip = dst;
+        buildRoute(fwd, rev, src, dst, (ecmpSwitch.selectCorePath(flow) + subflow) % N_CORE);
+    }
+
+    void generateCongaSubflowRoute(route_t *&fwd, route_t *&rev, uint32_t src, uint32_t dst, uint32_t subflow) {
+        TCPFlow flow;
+        flow.src_ip = src;
+        flow.dst_ip = dst;
+        buildRoute(fwd, rev, src, dst, (flowPathTable[flowHash(flow)] + subflow) % N_CORE);
     }
 
     void generateRandomRoute(route_t *&fwd, route_t *&rev, uint32_t &src, uint32_t &dst);
@@ -213,6 +242,9 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
     string FlowDist = "uniform";
     string FlowGen = "random";
     uint32_t Load = 50;
+    uint32_t FgLoad = 0;
+    string Trace = "";                // File containing trace to replay.
+    string TrafficMatrixFile = "";    // Leaf or server traffic matrix.
 
     // Parse command line arguments
     parseInt(args, "duration", Duration);
@@ -223,6 +255,9 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
     parseString(args, "flowdist", FlowDist);
     parseString(args, "flowgen", FlowGen);
     parseInt(args, "load", Load);
+    parseInt(args, "fgload", FgLoad);
+    parseString(args, "trace", Trace);
+    parseString(args, "tm", TrafficMatrixFile);
 
     Utilization = Load / 100.0;
 
@@ -302,6 +337,18 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
         eh = DataSource::DCTCP;
     } else if (EndHost == "tcp") {
         eh = DataSource::TCP;
+    } else if (EndHost == "dcqcn") {
+        eh = DataSource::DCQCN;
+    } else if (EndHost == "hpcc") {
+        eh = DataSource::HPCC;
+    } else if (EndHost == "swift") {
+        eh = DataSource::SWIFT;
+    } else if (EndHost == "ndp") {
+        eh = DataSource::NDP;
+    } else if (EndHost == "pfabric") {
+        eh = DataSource::PFABRIC;
+    } else if (EndHost == "mptcp") {
+        eh = DataSource::MPTCP;
     }
 
     // Configure flow distribution
@@ -311,6 +358,8 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
         fd = Workloads::ENTERPRISE;
     } else if (FlowDist == "datamining") {
         fd = Workloads::DATAMINING;
+    } else if (FlowDist == "cdf") {
+        fd = Workloads::EMPIRICAL;
     }
 
     // Calculate background traffic rate
@@ -321,20 +370,58 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
         // bgFlowGen = new FlowGenerator(eh, generateRandomRoute, bg_flow_rate, AvgFlowSize, fd);
     } else if (FlowGen == "ecmp") {
         bgFlowGen = new FlowGenerator(eh, generateECMPRoute, bg_flow_rate, AvgFlowSize, fd);
+        bgFlowGen->setSubflowRoutes(generateECMPSubflowRoute);
     } else if (FlowGen == "conga") {
         bgFlowGen = new FlowGenerator(eh, generateCongaRoute, bg_flow_rate, AvgFlowSize, fd);
+        bgFlowGen->setSubflowRoutes(generateCongaSubflowRoute);
+    }
+
+    // Both generators follow the same matrix.
+    TrafficMatrix *tm = NULL;
+    if (TrafficMatrixFile != "") {
+        tm = new TrafficMatrix(TrafficMatrixFile, N_LEAF * N_SERVER, N_SERVER);
     }
 
+    bgFlowGen->setFluid(FluidNetwork::_hybrid);
+    bgFlowGen->setTrafficMatrix(tm);
+    if (Trace != "") {
+        // With a foreground, class 0 of the trace is the background.
+        bgFlowGen->setTrace(Trace, FgLoad > 0 ? 0 : FLOW_CLASS_ANY);
+    }
     bgFlowGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
 
+    // Optional foreground traffic, packet-level even with a fluid background.
+    if (FgLoad > 0) {
+        double fg_flow_rate = FgLoad / 100.0 * (CORE_SPEED * N_CORE * N_LEAF);
+        FlowGenerator *fgFlowGen;
+        if (FlowGen == "conga") {
+            fgFlowGen = new FlowGenerator(eh, generateCongaRoute, fg_flow_rate, AvgFlowSize, fd);
+            fgFlowGen->setSubflowRoutes(generateCongaSubflowRoute);
+        } else {
+            fgFlowGen = new FlowGenerator(eh, generateECMPRoute, fg_flow_rate, AvgFlowSize, fd);
+            fgFlowGen->setSubflowRoutes(generateECMPSubflowRoute);
+        }
+        fgFlowGen->setPrefix("fg");
+        fgFlowGen->setClass(1);
+        fgFlowGen->setTrafficMatrix(tm);
+        if (Trace != "") {
+            fgFlowGen->setTrace(Trace, 1);
+        }
+        fgFlowGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+    }
+
     // Set simulation end time
     EventList::Get().setEndtime(timeFromMs(Duration));
 
-    cout << "Starting simulation with:\n"
+    OUTPUT(SUMMARY) << "Starting simulation with:\n"
          << "Algorithm: " << FlowGen << "\n"
          << "Workload: " << FlowDist << "\n"
          << "Load: " << Load << "%\n"
          << "Duration: " << Duration << "s\n";
+    if (FgLoad > 0) {
+        OUTPUT(SUMMARY) << "Foreground load: " << FgLoad << "%"
+             << (FluidNetwork::_hybrid ? ", background fluid" : "") << "\n";
+    }
 }
 
 // void
@@ -392,8 +479,12 @@ conga_testbed(const ArgList &args, Logfile &logfile) {
 
 void conga::createQueue(std::string &qType, Queue *&queue, uint64_t speed, uint64_t buffer, Logfile &logfile,
                         std::string name) {
-    QueueLoggerSampling *qs = new QueueLoggerSampling(timeFromMs(10));
-    logfile.addLogger(*qs);
+    // One sampler serves every queue in the fabric.
+    if (queueSampler == NULL) {
+        queueSampler = new MultiQueueLoggerSampling(timeFromMs(10));
+        logfile.addLogger(*queueSampler);
+    }
+    QueueLogger *qs = queueSampler->addQueue();
 
     // 解析队列名称
     bool isLeafQueue = (name.find("leaf-server") != string::npos ||
@@ -408,6 +499,7 @@ void conga::createQueue(std::string &qType, Queue *&queue, uint64_t speed, uint6
         core_id = stoi(name.substr(secondLastDash + 1, lastDash - secondLastDash - 1));
         CoreQueue *corequeue = new CoreQueue(speed, buffer, qs);
         corequeue->core_id = core_id;
+        corequeue->setTrimming(qType == "trim");
         queue = corequeue;
         return;
     }
@@ -424,6 +516,7 @@ void conga::createQueue(std::string &qType, Queue *&queue, uint64_t speed, uint6
             queue = new StocFairQueue(speed, buffer, qs);
         } else {
             queue = new Queue(speed, buffer, qs);
+            queue->setTrimming(qType == "trim");
         }
         return;
     }
@@ -436,6 +529,7 @@ void conga::createQueue(std::string &qType, Queue *&queue, uint64_t speed, uint6
     uint32_t core_id = 0;
 
     LeafSwitch *leafSwitch = new LeafSwitch(speed, buffer, qs);
+    leafSwitch->setTrimming(qType == "trim");
 
     // 根据不同类型的队列设置ID
     if (name.find("leaf-core") != string::npos) {
@@ -9,6 +9,7 @@
 #include "priorityqueue.h"
 #include "stoc-fairqueue.h"
 #include "flow-generator.h"
+#include "coflow-generator.h"
 #include "pipe.h"
 #include "test.h"
 #include "prof.h"
@@ -55,6 +56,8 @@ namespace fat_tree {
     Pipe  *pServerTor[N_SUBTREE][N_TOR][N_SERVER];
     Queue *qServerTor[N_SUBTREE][N_TOR][N_SERVER];
 
+    MultiQueueLoggerSampling *queueSampler = NULL;
+
     void generateRandomRoute(route_t *&fwd, route_t *&rev, uint32_t &src, uint32_t &dst);
     void createQueue(std::string &qType, Queue *&queue, uint64_t speed, uint64_t buffer, Logfile &lf);
 }
@@ -75,6 +78,9 @@ fat_tree_testbed(const ArgList &args,
     string calq = "cq";
     string fairqueue = "fq";
     string FlowDist = "uniform";
+    double CoflowLoad = 0;            // Coflow share of the core, fraction.
+    uint32_t Mappers = 4;             // Per coflow.
+    uint32_t Reducers = 4;
 
     parseInt(args, "duration", Duration);
     parseInt(args, "flowsize", AvgFlowSize);
@@ -83,6 +89,9 @@ fat_tree_testbed(const ArgList &args,
     parseString(args, "queue", QueueType);
     parseString(args, "endhost", EndHost);
     parseString(args, "flowdist", FlowDist);
+    parseDouble(args, "coflowload", CoflowLoad);
+    parseInt(args, "mappers", Mappers);
+    parseInt(args, "reducers", Reducers);
 
     // Aggregation to core switches and vice-versa.
     for (int i = 0; i < N_SUBTREE; i++) {
@@ -173,6 +182,18 @@ fat_tree_testbed(const ArgList &args,
         eh = DataSource::D_TCP;
     } else if (EndHost == "ddctcp") {
         eh = DataSource::D_DCTCP;
+    } else if (EndHost == "dcqcn") {
+        eh = DataSource::DCQCN;
+    } else if (EndHost == "hpcc") {
+        eh = DataSource::HPCC;
+    } else if (EndHost == "swift") {
+        eh = DataSource::SWIFT;
+    } else if (EndHost == "ndp") {
+        eh = DataSource::NDP;
+    } else if (EndHost == "pfabric") {
+        eh = DataSource::PFABRIC;
+    } else if (EndHost == "mptcp") {
+        eh = DataSource::MPTCP;
     }
 
     if (FlowDist == "pareto") {
@@ -181,6 +202,8 @@ fat_tree_testbed(const ArgList &args,
         fd = Workloads::ENTERPRISE;
     } else if (FlowDist == "datamining") {
         fd = Workloads::DATAMINING;
+    } else if (FlowDist == "cdf") {
+        fd = Workloads::EMPIRICAL;
     } else {
         fd = Workloads::UNIFORM;
     }
@@ -197,19 +220,19 @@ fat_tree_testbed(const ArgList &args,
     // Adjust for traffic not exiting the ToR.
     bg_flow_rate = bg_flow_rate * (N_SUBTREE * N_TOR) / (N_SUBTREE * N_TOR - 1);
 
-    // Create space for deadline/coflow traffic.
-    //bg_flow_rate = 0.5 * bg_flow_rate;
-
-    // Calculate deadline traffic rate.
-    //double deadline_flow_rate = 0.25 * bg_flow_rate;
-    //double deadline_flow_rate = bg_flow_rate;
+    // Coflow traffic rate, on top of the background.
+    double coflow_rate = CoflowLoad * (TOR_AGG_SPEED * N_SUBTREE * N_AGG * N_UPLINK);
+    coflow_rate = coflow_rate * (N_SUBTREE * N_TOR) / (N_SUBTREE * N_TOR - 1);
 
     FlowGenerator *bgFlowGen = new FlowGenerator(eh, generateRandomRoute, bg_flow_rate, AvgFlowSize, fd);
     bgFlowGen->setTimeLimits(timeFromUs(1), timeFromSec(Duration) - 1);
 
-    //CoflowGenerator *deadlineFlowGen = new CoflowGenerator(cfeh, generateRandomRoute, deadline_flow_rate);
-    //deadlineFlowGen->setTimeLimits(timeFromUs(1), timeFromSec(Duration) - 1);
-    //deadlineFlowGen->setPrefix("deadline");
+    if (CoflowLoad > 0) {
+        CoflowGenerator *coflowGen = new CoflowGenerator(cfeh, generateRandomRoute, coflow_rate,
+                                                         N_NODES, Mappers, Reducers, AvgFlowSize, fd);
+        coflowGen->setTimeLimits(timeFromUs(1), timeFromSec(Duration) - 1);
+        coflowGen->setPrefix("coflow");
+    }
 
     EventList::Get().setEndtime(timeFromSec(Duration));
 }
@@ -220,26 +243,27 @@ fat_tree::generateRandomRoute(route_t *&fwd,
                               uint32_t &src,
                               uint32_t &dst)
 {
-    if (dst != 0) {
+    Rng &rng = Rng::shared("fat-tree/routes");
+
+    if (dst != NODE_ANY) {
         dst = dst % N_NODES;
     } else {
-        dst = rand() % N_NODES;
+        dst = rng.below(N_NODES);
     }
 
-    if (src != 0) {
-        src = src % (N_NODES - 1);
+    if (src != NODE_ANY) {
+        src = src % N_NODES;
     } else {
-        src = rand() % (N_NODES - 1);
-    }
-
-    if (src >= dst) {
-        src++;
+        src = rng.below(N_NODES - 1);
+        if (src >= dst) {
+            src++;
+        }
     }
 
     uint32_t src_tree = src / N_NODES_SUBTREE;
     uint32_t dst_tree = dst / N_NODES_SUBTREE;
-    uint32_t uplink   = rand() % N_UPLINK;
-    uint32_t src_agg  = rand() % N_AGG;
+    uint32_t uplink   = rng.below(N_UPLINK);
+    uint32_t src_agg  = rng.below(N_AGG);
     uint32_t dst_agg  = src_agg;
     uint32_t src_tor  = (src / N_SERVER) % N_TOR;
     uint32_t dst_tor  = (dst / N_SERVER) % N_TOR;
@@ -297,14 +321,17 @@ fat_tree::createQueue(string &qType,
                       uint64_t buffer,
                       Logfile &logfile)
 {
+    if (queueSampler == NULL) {
 #if MING_PROF
-    QueueLoggerSampling *qs = new QueueLoggerSampling(timeFromUs(100));
-    //QueueLoggerSampling *qs = new QueueLoggerSampling(timeFromUs(10));
-    //QueueLoggerSampling *qs = new QueueLoggerSampling(timeFromUs(50));
+        queueSampler = new MultiQueueLoggerSampling(timeFromUs(100));
+        //queueSampler = new MultiQueueLoggerSampling(timeFromUs(10));
+        //queueSampler = new MultiQueueLoggerSampling(timeFromUs(50));
 #else
-    QueueLoggerSampling *qs = new QueueLoggerSampling(timeFromMs(10));
+        queueSampler = new MultiQueueLoggerSampling(timeFromMs(10));
 #endif
-    logfile.addLogger(*qs);
+        logfile.addLogger(*queueSampler);
+    }
+    QueueLogger *qs = queueSampler->addQueue();
 
     if (qType == "fq") {
         queue = new FairQueue(speed, buffer, qs);
@@ -316,5 +343,6 @@ fat_tree::createQueue(string &qType,
         queue = new StocFairQueue(speed, buffer, qs);
     } else {
         queue = new Queue(speed, buffer, qs);
+        queue->setTrimming(qType == "trim");
     }
 }
@@ -0,0 +1,192 @@
+/*
+ * Incast and RPC experiments
+ */
+#include "eventlist.h"
+#include "logfile.h"
+#include "incast-generator.h"
+#include "leaf_spine.h"
+#include "rpc-generator.h"
+#include "test.h"
+#include "output.h"
+#include "switch/constants.h"
+
+/*
+ * Partition-aggregate on the CONGA leaf-spine: FIFO ports with ECN marking
+ * (Queue::dctcpThreshold, --ecnthresh=), flows hashed onto a core as with
+ * ECMP. Queries fan in to one server in synchronized bursts, so its leaf
+ * port's buffer and marking threshold decide how many responses time out;
+ * an optional Poisson background shares the fabric. The RPC experiment
+ * runs closed-loop request/response traffic on the same fabric instead.
+ */
+namespace incast {
+    using conga::N_CORE;
+    using conga::N_LEAF;
+    using conga::N_SERVER;
+    using conga::CORE_SPEED;
+    using conga::LEAF_BUFFER;
+
+    bool trimming = false;
+
+    Queue *createQueue(linkspeed_bps speed, mem_b buffer, QueueLogger *logger);
+    DataSource::EndHost endhostType(const std::string &name);
+    Workloads::FlowDist flowDist(const std::string &name);
+}
+
+using namespace std;
+using namespace incast;
+
+void
+incast_testbed(const ArgList &args,
+               Logfile &logfile)
+{
+    uint32_t Duration = 5;            // ms
+    uint32_t FanIn = 32;              // Senders per query.
+    uint64_t ResponseSize = 10000;    // Bytes per sender.
+    double Period = 500;              // us between queries.
+    uint32_t Buffer = LEAF_BUFFER;    // Switch port buffer.
+    uint32_t Load = 0;                // Background load, % of the core.
+    uint32_t AvgFlowSize = 100000;
+    string QueueType = "droptail";
+    string EndHost = "dctcp";
+    string FlowDist = "uniform";
+
+    parseInt(args, "duration", Duration);
+    parseInt(args, "fanin", FanIn);
+    parseLongInt(args, "response", ResponseSize);
+    parseDouble(args, "period", Period);
+    parseInt(args, "buffer", Buffer);
+    parseInt(args, "load", Load);
+    parseInt(args, "flowsize", AvgFlowSize);
+    parseString(args, "queue", QueueType);
+    parseString(args, "endhost", EndHost);
+    parseString(args, "flowdist", FlowDist);
+
+    trimming = (QueueType == "trim");
+
+    leafspine::build("incast", createQueue, Buffer, logfile);
+    DataSource::EndHost eh = endhostType(EndHost);
+    Workloads::FlowDist fd = flowDist(FlowDist);
+
+    IncastGenerator *incastGen = new IncastGenerator(eh, leafspine::generateRoute, N_LEAF * N_SERVER,
+                                                     FanIn, ResponseSize, timeFromUs(Period));
+    incastGen->setPrefix("incast");
+    incastGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+
+    if (Load > 0) {
+        double bg_flow_rate = Load / 100.0 * (CORE_SPEED * N_CORE * N_LEAF);
+        FlowGenerator *bgFlowGen = new FlowGenerator(eh, leafspine::generateRoute, bg_flow_rate, AvgFlowSize, fd);
+        bgFlowGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+    }
+
+    EventList::Get().setEndtime(timeFromMs(Duration));
+
+    OUTPUT(SUMMARY) << "Starting simulation with:\n"
+         << "Algorithm: incast\n"
+         << "Fan-in: " << FanIn << " x " << ResponseSize << "B every " << Period << "us\n"
+         << "Buffer: " << Buffer << "B\n"
+         << "Load: " << Load << "%\n"
+         << "Duration: " << Duration << "ms\n";
+}
+
+void
+rpc_testbed(const ArgList &args,
+            Logfile &logfile)
+{
+    uint32_t Duration = 5;            // ms
+    uint32_t Clients = 64;
+    uint32_t Outstanding = 4;         // RPCs per client.
+    uint64_t RequestSize = 1000;      // Bytes.
+    uint32_t AvgFlowSize = 10000;     // Mean response size.
+    double ThinkTime = 0;             // Mean, us.
+    uint32_t Buffer = LEAF_BUFFER;
+    uint32_t Load = 0;
+    string QueueType = "droptail";
+    string EndHost = "dctcp";
+    string FlowDist = "uniform";
+
+    parseInt(args, "duration", Duration);
+    parseInt(args, "clients", Clients);
+    parseInt(args, "outstanding", Outstanding);
+    parseLongInt(args, "request", RequestSize);
+    parseInt(args, "flowsize", AvgFlowSize);
+    parseDouble(args, "think", ThinkTime);
+    parseInt(args, "buffer", Buffer);
+    parseInt(args, "load", Load);
+    parseString(args, "queue", QueueType);
+    parseString(args, "endhost", EndHost);
+    parseString(args, "flowdist", FlowDist);
+
+    trimming = (QueueType == "trim");
+
+    leafspine::build("rpc", createQueue, Buffer, logfile);
+    DataSource::EndHost eh = endhostType(EndHost);
+    Workloads::FlowDist fd = flowDist(FlowDist);
+
+    RpcGenerator *rpcGen = new RpcGenerator(eh, leafspine::generateRoute, N_LEAF * N_SERVER, Clients, Outstanding,
+                                            RequestSize, AvgFlowSize, fd, timeFromUs(ThinkTime));
+    rpcGen->setPrefix("rpc");
+    rpcGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+
+    // Background of the same response sizes.
+    if (Load > 0) {
+        double bg_flow_rate = Load / 100.0 * (CORE_SPEED * N_CORE * N_LEAF);
+        FlowGenerator *bgFlowGen = new FlowGenerator(eh, leafspine::generateRoute, bg_flow_rate, AvgFlowSize, fd);
+        bgFlowGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+    }
+
+    EventList::Get().setEndtime(timeFromMs(Duration));
+
+    OUTPUT(SUMMARY) << "Starting simulation with:\n"
+         << "Algorithm: rpc\n"
+         << "Clients: " << Clients << " x " << Outstanding << " outstanding, request "
+         << RequestSize << "B, think " << ThinkTime << "us\n"
+         << "Workload: " << FlowDist << "\n"
+         << "Load: " << Load << "%\n"
+         << "Duration: " << Duration << "ms\n";
+}
+
+Queue *
+incast::createQueue(linkspeed_bps speed,
+                    mem_b buffer,
+                    QueueLogger *logger)
+{
+    Queue *queue = new Queue(speed, buffer, logger);
+    queue->setTrimming(trimming);
+    return queue;
+}
+
+DataSource::EndHost
+incast::endhostType(const string &name)
+{
+    DataSource::EndHost eh = DataSource::DCTCP;
+
+    if (name == "tcp") {
+        eh = DataSource::TCP;
+    } else if (name == "dcqcn") {
+        eh = DataSource::DCQCN;
+    } else if (name == "hpcc") {
+        eh = DataSource::HPCC;
+    } else if (name == "swift") {
+        eh = DataSource::SWIFT;
+    } else if (name == "ndp") {
+        eh = DataSource::NDP;
+    }
+    return eh;
+}
+
+Workloads::FlowDist
+incast::flowDist(const string &name)
+{
+    Workloads::FlowDist fd = Workloads::UNIFORM;
+
+    if (name == "pareto") {
+        fd = Workloads::PARETO;
+    } else if (name == "enterprise") {
+        fd = Workloads::ENTERPRISE;
+    } else if (name == "datamining") {
+        fd = Workloads::DATAMINING;
+    } else if (name == "cdf") {
+        fd = Workloads::EMPIRICAL;
+    }
+    return fd;
+}
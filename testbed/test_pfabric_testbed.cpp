@@ -0,0 +1,95 @@
+/*
+ * pFabric experiment
+ */
+#include "eventlist.h"
+#include "logfile.h"
+#include "priorityqueue.h"
+#include "flow-generator.h"
+#include "leaf_spine.h"
+#include "test.h"
+#include "output.h"
+#include "switch/constants.h"
+
+/*
+ * pFabric (Alizadeh et al., SIGCOMM 2013) on the CONGA leaf-spine: same
+ * topology, link speeds and workload as conga_testbed, so the FCTs compare
+ * directly with CONGA/ECMP + DCTCP. Every port is a shallow PriorityQueue
+ * serving the packet with the least remaining flow size and dropping the
+ * one with the most; flows are hashed onto a core as with ECMP.
+ */
+namespace pfabric {
+    using conga::N_CORE;
+    using conga::N_LEAF;
+    using conga::CORE_SPEED;
+
+    // About two BDPs per port, as in the paper.
+    const uint64_t PORT_BUFFER = 36000;
+
+    Queue *createQueue(linkspeed_bps speed, mem_b buffer, QueueLogger *logger);
+}
+
+using namespace std;
+using namespace pfabric;
+
+void
+pfabric_testbed(const ArgList &args,
+                Logfile &logfile)
+{
+    uint32_t Duration = 5;
+    uint32_t AvgFlowSize = 100000;
+    uint32_t Load = 50;
+    uint32_t Buffer = PORT_BUFFER;
+    string EndHost = "pfabric";
+    string FlowDist = "uniform";
+
+    parseInt(args, "duration", Duration);
+    parseInt(args, "flowsize", AvgFlowSize);
+    parseInt(args, "load", Load);
+    parseInt(args, "buffer", Buffer);
+    parseString(args, "endhost", EndHost);
+    parseString(args, "flowdist", FlowDist);
+
+    // Every port, host NICs included, is a PriorityQueue.
+    leafspine::build("pfabric", createQueue, Buffer, logfile);
+
+    DataSource::EndHost eh = DataSource::PFABRIC;
+    Workloads::FlowDist fd = Workloads::UNIFORM;
+
+    if (EndHost == "dctcp") {
+        eh = DataSource::DCTCP;
+    } else if (EndHost == "tcp") {
+        eh = DataSource::TCP;
+    }
+
+    if (FlowDist == "pareto") {
+        fd = Workloads::PARETO;
+    } else if (FlowDist == "enterprise") {
+        fd = Workloads::ENTERPRISE;
+    } else if (FlowDist == "datamining") {
+        fd = Workloads::DATAMINING;
+    } else if (FlowDist == "cdf") {
+        fd = Workloads::EMPIRICAL;
+    }
+
+    // Same offered load as conga_testbed.
+    double bg_flow_rate = Load / 100.0 * (CORE_SPEED * N_CORE * N_LEAF);
+
+    FlowGenerator *bgFlowGen = new FlowGenerator(eh, leafspine::generateRoute, bg_flow_rate, AvgFlowSize, fd);
+    bgFlowGen->setTimeLimits(timeFromUs(1), timeFromMs(Duration) - 1);
+
+    EventList::Get().setEndtime(timeFromMs(Duration));
+
+    OUTPUT(SUMMARY) << "Starting simulation with:\n"
+         << "Algorithm: pfabric\n"
+         << "Workload: " << FlowDist << "\n"
+         << "Load: " << Load << "%\n"
+         << "Duration: " << Duration << "ms\n";
+}
+
+Queue *
+pfabric::createQueue(linkspeed_bps speed,
+                     mem_b buffer,
+                     QueueLogger *logger)
+{
+    return new PriorityQueue(speed, buffer, logger);
+}
@@ -76,6 +76,7 @@ void single_link_simulation(const ArgList &args, Logfile &logfile)
         queueFwd = new StocFairQueue(LinkSpeed, LinkBuffer, qs);
     } else {
         queueFwd = new Queue(LinkSpeed, LinkBuffer, qs);
+        queueFwd->setTrimming(QueueType == "trim");
     }
 
     queueFwd->setName("queueFwd");
@@ -100,6 +101,18 @@ void single_link_simulation(const ArgList &args, Logfile &logfile)
         eh = DataSource::TIMELY;
     } else if (EndHost == "dctcp") {
         eh = DataSource::DCTCP;
+    } else if (EndHost == "dcqcn") {
+        eh = DataSource::DCQCN;
+    } else if (EndHost == "hpcc") {
+        eh = DataSource::HPCC;
+    } else if (EndHost == "swift") {
+        eh = DataSource::SWIFT;
+    } else if (EndHost == "ndp") {
+        eh = DataSource::NDP;
+    } else if (EndHost == "pfabric") {
+        eh = DataSource::PFABRIC;
+    } else if (EndHost == "mptcp") {
+        eh = DataSource::MPTCP;
     }
 
     if (FlowDist == "pareto") {
@@ -108,6 +121,8 @@ void single_link_simulation(const ArgList &args, Logfile &logfile)
         fd = Workloads::ENTERPRISE;
     } else if (FlowDist == "datamining") {
         fd = Workloads::DATAMINING;
+    } else if (FlowDist == "cdf") {
+        fd = Workloads::EMPIRICAL;
     }
 
     /* Configure flow generator. */
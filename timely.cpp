@@ -1,5 +1,7 @@
 #include "timely.h"
 #include "flow-generator.h"
+#include "fct-stats.h"
+#include "output.h"
 
 #define TRACE_FLOW 0 && "timelySrc27"
 
@@ -13,6 +15,7 @@ TimelySrc::TimelySrc(TrafficLogger *pktlogger,
       _dupacks(0),
       _bdp_estimate(0),
       _rate(10000000000),
+      _pace_next(0),
       _drops(0),
       _rtt(0),
       _rto(timeFromUs(INIT_RTO_US)),
@@ -42,11 +45,11 @@ TimelySrc::printStatus()
         estimated_fct = 0;
     }
 
-    cout << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
+    OUTPUT(LIVE_FLOW) << setprecision(6) << "LiveFlow " << str() << " size " << _flowsize
          << " start " << lround(timeAsUs(_start_time)) << " end " << _last_acked
          << " fct " << timeAsUs(estimated_fct)
          << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
-         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time) << endl;
+         << " rate " << _last_acked * 8000.0 / (current_ts - _start_time) << '\n';
 }
 
 void
@@ -54,22 +57,30 @@ TimelySrc::doNextEvent()
 {
     simtime_picosec current_ts = EventList::Get().now();
 
-    if (TRACE_FLOW == str()) {
-        cout << str() << " EV " << timeAsUs(current_ts) << " " << _state << " "
-             << timeAsUs(_rto_timeout) << " " << _flow._nPackets << endl;
-    }
-
-    // If this is the first transmission, send a packet-pair, set rto and return.
+    // First transmission: from here on the pacer clocks this flow.
     if (_state == IDLE) {
         _highest_sent = 0;
         _last_acked = 0;
         _bdp_estimate = 8 * MSS_BYTES;
         _last_rtt_update = current_ts;
+        _pace_next = current_ts;
         _state = NORMAL;
+        pacedSend();
+    }
+}
+
+void
+TimelySrc::pacedSend()
+{
+    simtime_picosec current_ts = EventList::Get().now();
+
+    if (TRACE_FLOW == str()) {
+        cout << str() << " EV " << timeAsUs(current_ts) << " " << _state << " "
+             << timeAsUs(_rto_timeout) << " " << _flow._nPackets << endl;
     }
 
     // Cleanup the finished flow.
-    else if (_state == FINISH) {
+    if (_state == FINISH) {
         if (_flow._nPackets == 0) {
             delete _sink;
             delete _route_fwd;
@@ -82,13 +93,13 @@ TimelySrc::doNextEvent()
     // Retransmission timeout.
     else if (_rto_timeout != 0 && current_ts >= _rto_timeout) {
 
-        cout << str() << " at " << timeAsMs(current_ts)
+        OUTPUT(RTO) << str() << " at " << timeAsMs(current_ts)
              << " RTO " << timeAsUs(_rto)
              << " MDEV " << timeAsUs(_mdev)
              << " RTT "<< timeAsUs(_rtt)
              << " SEQ " << _last_acked
              << " RTO_timeout " << timeAsMs(_rto_timeout)
-             << " STATE " << _state << endl;
+             << " STATE " << _state << '\n';
 
         _recover_seq = _highest_sent;
         _highest_sent = _last_acked + MSS_BYTES;
@@ -103,12 +114,12 @@ TimelySrc::doNextEvent()
 
     if (_state != FINISH) {
         sendPackets(current_ts);
-    } 
+    }
 
     /* Schedule next transmission. Time to transmit MSS_BYTES at estimated link rate. */
-    simtime_picosec nextTransmission = timeFromSec((MSS_BYTES * 8.0)/_rate);
-
-    EventList::Get().sourceIsPendingRel(*this, nextTransmission);
+    Pacer &pacer = Pacer::Get();
+    _pace_next = pacer.nextSendTime(_pace_next, timeFromSec((MSS_BYTES * 8.0)/_rate));
+    pacer.schedule(*this, _pace_next);
 }
 
 void
@@ -134,21 +145,22 @@ TimelySrc::receivePacket(Packet& pkt)
             _flowgen->finishFlow(id);
         }
         _state = FINISH;
+        FctStats::Get().recordFlow(*this, current_ts);
 
-        cout << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
+        OUTPUT(FLOW_FINISH) << setprecision(6) << "Flow " << str() << "-" << id << " size " << _flowsize
              << " start " << lround(timeAsUs(_start_time)) << " end " << lround(timeAsUs(current_ts))
              << " fct " << timeAsUs(current_ts - _start_time)
              << " sent " << _highest_sent << " " << _packets_sent - _highest_sent
              << " rate " << _flowsize * 8000.0 / (current_ts - _start_time)
              << " bdp " << _bdp_estimate
-             << " minrtt " << _min_rtt << endl;
+             << " minrtt " << _min_rtt << '\n';
 
         return;
     }
 
     // Delayed / reordered ack. Shouldn't happen for simple queues.
     if (seqno < _last_acked) {
-        cout << str() << " ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << endl;
+        OUTPUT(WARNING) << str() << " ACK from the past: seqno " << seqno << " _last_acked " << _last_acked << '\n';
         return;
     }
 
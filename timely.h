@@ -3,6 +3,7 @@
 
 #include "eventlist.h"
 #include "datasource.h"
+#include "pacer.h"
 
 #define T_LOW timeFromUs(20)
 #define T_HIGH timeFromUs(100)
@@ -13,7 +14,7 @@
 class TimelySink;
 class FlowGenerator;
 
-class TimelySrc : public DataSource
+class TimelySrc : public DataSource, public PacedSource
 {
 friend class TimelySink;
 public:
@@ -24,6 +25,9 @@ public:
     void doNextEvent();
     void receivePacket(Packet &pkt);
 
+    // Transmissions are clocked by the shared Pacer at _rate.
+    void pacedSend();
+
     // Flow status.
     enum FlowStatus {
         IDLE,
@@ -37,6 +41,7 @@ public:
     uint16_t _dupacks;
     uint64_t _bdp_estimate;
     linkspeed_bps _rate;
+    simtime_picosec _pace_next; // Ideal time of the next transmission.
 
     // Number of estimated packet drops.
     uint32_t _drops;
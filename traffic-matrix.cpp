@@ -0,0 +1,138 @@
+/*
+ * Traffic matrix
+ */
+#include "traffic-matrix.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace std;
+
+TrafficMatrix::TrafficMatrix(const string &filename,
+                             uint32_t nHosts,
+                             uint32_t hostsPerLeaf)
+    : _current(0),
+    _n(0),
+    _nHosts(nHosts),
+    _hostsPerLeaf(hostsPerLeaf),
+    _byLeaf(false)
+{
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening traffic matrix: %s\n", filename.c_str());
+        exit(1);
+    }
+
+    char token[64];
+    simtime_picosec start = 0;
+    vector<double> weights;
+    while (fscanf(fp, " %63s", token) == 1) {
+        if (token[0] == '#') {
+            if (fscanf(fp, "%*[^\n]") < 0) {
+                break;
+            }
+        } else if (strcmp(token, "epoch") == 0) {
+            double startUs;
+            if (fscanf(fp, " %lf", &startUs) != 1) {
+                fprintf(stderr, "Bad epoch in traffic matrix: %s\n", filename.c_str());
+                exit(1);
+            }
+            if (!weights.empty() || !_epochs.empty()) {
+                addEpoch(start, weights);
+            }
+            start = timeFromUs(startUs);
+            weights.clear();
+        } else {
+            char *end;
+            double w = strtod(token, &end);
+            if (*end != '\0' || w < 0) {
+                fprintf(stderr, "Bad weight '%s' in traffic matrix: %s\n", token, filename.c_str());
+                exit(1);
+            }
+            weights.push_back(w);
+        }
+    }
+    fclose(fp);
+    addEpoch(start, weights);
+}
+
+void
+TrafficMatrix::addEpoch(simtime_picosec start,
+                        const vector<double> &weights)
+{
+    uint32_t n = llround(sqrt((double)weights.size()));
+    if (n == 0 || (size_t)n * n != weights.size()) {
+        fprintf(stderr, "Traffic matrix epoch at %.3f us is not square\n", timeAsUs(start));
+        exit(1);
+    }
+
+    if (_epochs.empty()) {
+        if (start != 0) {
+            fprintf(stderr, "Traffic matrix must start at 0\n");
+            exit(1);
+        }
+        if (n == _nHosts) {
+            _byLeaf = false;
+        } else if ((uint64_t)n * _hostsPerLeaf == _nHosts) {
+            _byLeaf = true;
+        } else {
+            fprintf(stderr, "Traffic matrix of %u rows fits neither %u hosts nor %u leaves\n",
+                    n, _nHosts, _nHosts / _hostsPerLeaf);
+            exit(1);
+        }
+        _n = n;
+    } else if (n != _n || start <= _epochs.back().start) {
+        fprintf(stderr, "Traffic matrix epoch at %.3f us is out of order or resized\n",
+                timeAsUs(start));
+        exit(1);
+    }
+
+    // Only pairs that carry traffic get a column; between two hosts a
+    // pair needs two different ones.
+    _epochs.push_back(Epoch());
+    Epoch &epoch = _epochs.back();
+    epoch.start = start;
+    vector<double> pairWeights;
+    for (uint32_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < n; j++) {
+            double w = weights[i * n + j];
+            if (w > 0 && (_byLeaf ? _hostsPerLeaf > 1 || i != j : i != j)) {
+                pairWeights.push_back(w);
+                epoch.ends.push_back(make_pair(i, j));
+            }
+        }
+    }
+    if (pairWeights.empty()) {
+        fprintf(stderr, "Traffic matrix epoch at %.3f us carries no traffic\n", timeAsUs(start));
+        exit(1);
+    }
+    epoch.pairs.build(pairWeights);
+}
+
+void
+TrafficMatrix::sample(Rng &rng,
+                      uint32_t &src,
+                      uint32_t &dst)
+{
+    simtime_picosec now = EventList::Get().now();
+    while (_current + 1 < _epochs.size() && _epochs[_current + 1].start <= now) {
+        _current++;
+    }
+
+    const Epoch &epoch = _epochs[_current];
+    const pair<uint32_t,uint32_t> &ends = epoch.ends[epoch.pairs.sample(rng)];
+    if (!_byLeaf) {
+        src = ends.first;
+        dst = ends.second;
+        return;
+    }
+
+    src = ends.first * _hostsPerLeaf + rng.below(_hostsPerLeaf);
+    if (ends.first != ends.second) {
+        dst = ends.second * _hostsPerLeaf + rng.below(_hostsPerLeaf);
+    } else {
+        uint32_t other = rng.below(_hostsPerLeaf - 1);
+        dst = ends.second * _hostsPerLeaf + (other >= src % _hostsPerLeaf ? other + 1 : other);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Traffic matrix header
+ */
+#ifndef TRAFFIC_MATRIX_H
+#define TRAFFIC_MATRIX_H
+
+#include "eventlist.h"
+#include "sampler.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * Where flows go: the share of traffic between every pair of leaves (or
+ * hosts), in epochs that each hold from their start time to the next.
+ * A FlowGenerator with one (setTrafficMatrix) keeps its single Poisson
+ * arrival process at the aggregate rate and sends each flow between a
+ * pair drawn from the current epoch's matrix.
+ *
+ * File format: '#' comments, then for every epoch a line
+ *   epoch <start us>
+ * and n rows of n non-negative weights, row i the traffic from leaf (or
+ * host) i. A matrix as large as the number of hosts is host to host,
+ * the diagonal ignored; one as large as the number of leaves is leaf to
+ * leaf, with hosts drawn uniformly within each (two different ones on
+ * the diagonal). Epochs must come in order, the first at 0; a file with
+ * no epoch line is one matrix for the whole run.
+ */
+class TrafficMatrix
+{
+    public:
+        TrafficMatrix(const std::string &filename, uint32_t nHosts, uint32_t hostsPerLeaf);
+
+        // A src, dst pair of hosts for a flow starting now, from the
+        // epoch that holds now.
+        void sample(Rng &rng, uint32_t &src, uint32_t &dst);
+
+        uint32_t nEpochs() const { return _epochs.size(); }
+
+    private:
+        struct Epoch {
+            simtime_picosec start;
+            AliasTable pairs;
+            std::vector<std::pair<uint32_t,uint32_t> > ends; // By pair index.
+        };
+
+        // Add an epoch of the n x n weights, row by row.
+        void addEpoch(simtime_picosec start, const std::vector<double> &weights);
+
+        std::vector<Epoch> _epochs;
+        uint32_t _current;
+        uint32_t _n;                // Rows of every matrix.
+        uint32_t _nHosts;
+        uint32_t _hostsPerLeaf;
+        bool _byLeaf;
+};
+
+#endif /* TRAFFIC_MATRIX_H */
@@ -3,24 +3,93 @@
  */
 #include "workloads.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
 using namespace std;
 
+CdfSampler Workloads::_empiricalCDF;
+
 Workloads::Workloads(uint32_t avgFlowSize, 
                      FlowDist flowSizeDist)
                     : _avgFlowSize(avgFlowSize),
-                    _flowSizeDist(flowSizeDist)
+                    _flowSizeDist(flowSizeDist),
+                    _rng(Rng::nameFor("workload"))
 {
     if (_flowSizeDist == ENTERPRISE) {
-        _avgFlowSize = 215000;
-        for (uint32_t i = 0; i < sizeof(enterprise_size)/8; i++) {
-            _flowSizeCDF[enterprise_prob[i]] = enterprise_size[i];
-        }
+        _flowSizeCDF.build(enterprise_prob, enterprise_size,
+                           sizeof(enterprise_size) / sizeof(enterprise_size[0]));
     } else if (_flowSizeDist == DATAMINING) {
-        _avgFlowSize = 12500000;
-        for (uint32_t i = 0; i < sizeof(datamining_size)/8; i++) {
-            _flowSizeCDF[datamining_prob[i]] = datamining_size[i];
+        _flowSizeCDF.build(datamining_prob, datamining_size,
+                           sizeof(datamining_size) / sizeof(datamining_size[0]));
+    } else if (_flowSizeDist == EMPIRICAL) {
+        if (_empiricalCDF.empty()) {
+            fprintf(stderr, "Empirical flow sizes need a CDF file (--cdf=)\n");
+            exit(1);
+        }
+        _flowSizeCDF = _empiricalCDF;
+    }
+
+    if (!_flowSizeCDF.empty()) {
+        _avgFlowSize = llround(_flowSizeCDF.mean());
+    }
+}
+
+void
+Workloads::loadCdf(const string &filename)
+{
+    FILE *fp = fopen(filename.c_str(), "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Error opening flow size CDF: %s\n", filename.c_str());
+        exit(1);
+    }
+
+    vector<uint64_t> sizes;
+    vector<double> probs;
+    char line[256];
+    uint32_t lineNo = 0;
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        lineNo++;
+        char *comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
         }
+
+        double size, prob;
+        char extra;
+        int n = sscanf(line, " %lf %lf %c", &size, &prob, &extra);
+        if (n <= 0) {
+            continue;
+        }
+        // A zero-byte flow never completes, so sizes start at 1 byte.
+        if (n != 2 || size < 1 || prob < 0
+            || (!sizes.empty() && (size < sizes.back() || prob < probs.back()))) {
+            fprintf(stderr, "Bad line %u in flow size CDF: %s\n", lineNo, filename.c_str());
+            exit(1);
+        }
+        if (sizes.empty() && prob > 0) {
+            sizes.push_back((uint64_t)size);
+            probs.push_back(0);
+        }
+        sizes.push_back((uint64_t)size);
+        probs.push_back(prob);
+    }
+    fclose(fp);
+
+    double last = probs.empty() ? 0 : probs.back();
+    double scale = fabs(last - 100) < 1e-6 ? 100 : 1;
+    if (sizes.size() < 2 || fabs(last / scale - 1) > 1e-6) {
+        fprintf(stderr, "Flow size CDF does not reach 1: %s\n", filename.c_str());
+        exit(1);
     }
+    for (double &p : probs) {
+        p /= scale;
+    }
+
+    _empiricalCDF.build(probs.data(), sizes.data(), sizes.size());
 }
 
 uint64_t
@@ -28,26 +97,30 @@ Workloads::generateFlowSize()
 {
     switch (_flowSizeDist) {
         case PARETO:
-            // Pareto
-            return (uint64_t)pareto(1.1, _avgFlowSize);
+            // Pareto, at least 1 byte.
+            return max<uint64_t>(1, (uint64_t)_rng.pareto(1.1, _avgFlowSize));
 
         case ENTERPRISE:
         case DATAMINING:
+        case EMPIRICAL:
             // Custom workload, generate using _flowSizeCDF.
-            break;
+            return _flowSizeCDF.sample(_rng);
 
         default: // UNIFORM
             return _avgFlowSize;
     }
+}
 
-    double random = drand();
-    auto it = _flowSizeCDF.upper_bound(random);
-    double rp = it->first;
-    uint64_t rv = it->second;
-    it = prev(it);
-    double lp = it->first;
-    uint64_t lv = it->second;
+void
+Workloads::generateFlowSizes(uint64_t *out,
+                             uint32_t n)
+{
+    if (!_flowSizeCDF.empty()) {
+        _flowSizeCDF.sample(_rng, out, n);
+        return;
+    }
 
-    uint64_t flowsize = lv + (rv - lv) * (random - lp) / (rp - lp);
-    return flowsize;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = generateFlowSize();
+    }
 }
@@ -5,7 +5,10 @@
 #define WORKLOADS_H
 
 #include "htsim.h"
-#include <map>
+#include "rng.h"
+#include "sampler.h"
+
+#include <string>
 
 class Workloads
 {
@@ -15,7 +18,8 @@ class Workloads
             UNIFORM,    // All flows are of the same size
             PARETO,     // Pareto distributed with shape (alpha) 1.2
             ENTERPRISE, // Enterprise workload from CONGA paper.
-            DATAMINING  // Datamining workload from CONGA paper.
+            DATAMINING, // Datamining workload from CONGA paper.
+            EMPIRICAL   // CDF loaded from a file (loadCdf).
         };
 
         Workloads(uint32_t avgFlowSize, FlowDist flowSizeDist);
@@ -23,11 +27,23 @@ class Workloads
         // Returns a flow size according to some distribution.
         uint64_t generateFlowSize();
 
+        // Fills out with n flow sizes.
+        void generateFlowSizes(uint64_t *out, uint32_t n);
+
+        // Reads the EMPIRICAL distribution: lines of "<size bytes> <cdf>",
+        // the cdf rising to 1 (or 100, as percent); '#' starts a comment.
+        // A first cdf above 0 is a point mass at that size.
+        static void loadCdf(const std::string &filename);
+        static CdfSampler _empiricalCDF;
+
         uint32_t _avgFlowSize;        // Average flowsize in bytes.
-        uint32_t _flowSizeDist;       // Distribution of flow size [0/1/2] - Uniform/Exp/Pareto.
+        uint32_t _flowSizeDist;       // Distribution of flow size, a FlowDist.
 
         // Custom flow size distribution.
-        std::map<double,uint64_t> _flowSizeCDF;
+        CdfSampler _flowSizeCDF;
+
+        // Flow sizes are drawn from a stream of their own.
+        Rng _rng;
 };
 
 